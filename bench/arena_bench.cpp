@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <string>
+
+#include "../src/include/arena.hpp"
+
+// Heap allocations made so far, counted by the global operator new below
+static size_t allocations = 0;
+
+// The replacements are kept out of line: inlined into a delete expression,
+// free() would look mismatched with the new expression to the compiler
+__attribute__((noinline)) void *operator new(size_t size) {
+    ++allocations;
+    void *p = malloc(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+/**
+ * Builds a book list as the server sends it.
+ * @param books The number of books.
+ * @return The JSON document.
+ */
+static std::string bench_catalog(size_t books) {
+    std::string text = "[";
+    for (size_t i = 1; i <= books; ++i) {
+        if (i > 1) text += ",";
+        text += "{\"id\":" + std::to_string(i) + ",\"title\":\"The title of book number " + std::to_string(i) +
+                "\",\"author\":\"Author " + std::to_string(i % 97) +
+                "\",\"genre\":\"Fiction\",\"publisher\":\"Publishing house\",\"page_count\":" +
+                std::to_string(100 + i % 900) + "}";
+    }
+    return text + "]";
+}
+
+/**
+ * Benchmarks parsing into nlohmann::json on the global heap against
+ * arena_json inside a command_arena, as every command does: heap
+ * allocations and wall time per parse, from a single book (the get_book
+ * reply, pretty-printed too) to a list of 1M books.
+ */
+int main() {
+    for (size_t books : {1, 1000, 100000, 1000000}) {
+        std::string text = bench_catalog(books);
+        int reps = books >= 100000 ? 3 : (books == 1 ? 100000 : 300);
+        std::string single = books == 1 ? text.substr(1, text.size() - 2) : text;
+        size_t sink = 0;
+
+        size_t a0 = allocations;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            nlohmann::json value = nlohmann::json::parse(single);
+            sink += value.size();
+            if (books == 1) sink += value.dump(4).size();
+        }
+
+        size_t a1 = allocations;
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            command_arena arena;
+            arena_json value = arena_json::parse(single);
+            sink += value.size();
+            if (books == 1) sink += value.dump(4).size();
+        }
+
+        size_t a2 = allocations;
+        auto t2 = std::chrono::steady_clock::now();
+
+        auto ms = [reps](auto start, auto stop) {
+            return std::chrono::duration<double, std::milli>(stop - start).count() / reps;
+        };
+        printf("%8zu books: heap %10.0f allocations %9.3f ms | arena %8.0f allocations %9.3f ms (%zu)\n",
+               books, (double)(a1 - a0) / reps, ms(t0, t1), (double)(a2 - a1) / reps, ms(t1, t2), sink % 10);
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "../src/lib/json.hpp"
+#include "../src/utils/ondemand.hpp"
+
+// Mutated documents checked against nlohmann::json::accept()
+#define BENCH_FUZZ 200000
+
+// Bytes the fuzzer inserts: JSON syntax, escapes and UTF-8 lead and continuation bytes
+static const char BENCH_ALPHABET[] = "{}[]\":,\\ 0123456789.eE-+truefalsnuDd\x01\x7f\x80\xbf\xc3\xe0\xed\xf0\xf4\xff";
+
+/**
+ * Builds a book list as the server sends it, with escapes and non-ASCII
+ * text in every title.
+ * @param books The number of books.
+ * @return The JSON document.
+ */
+static std::string bench_catalog(size_t books) {
+    std::string text = "[";
+    for (size_t i = 1; i <= books; ++i) {
+        if (i > 1) text += ",";
+        text += "{\"id\":" + std::to_string(i) + ",\"title\":\"Title \\\"" + std::to_string(i) +
+                "\\\" \\u00e9 \xc3\xa9\",\"author\":\"Author " + std::to_string(i % 97) +
+                "\",\"genre\":\"Fiction\",\"publisher\":\"Pub\",\"page_count\":" + std::to_string(100 + i % 900) + "}";
+    }
+    return text + "]";
+}
+
+/**
+ * Checks that json_validate() accepts exactly what nlohmann::json accepts,
+ * on randomly mutated documents, and that strings decode the same.
+ * @return The number of disagreements.
+ */
+static int check(void) {
+    std::mt19937 rng(1);
+    const std::string documents[] = {
+        bench_catalog(3),
+        "{\"error\":\"x\\\\\",\"token\":\"a\\\"b \\ud83d\\ude00 \xf0\x9f\x98\x80\",\"n\":[1,{\"k\":null}]}"
+    };
+    int bad = 0;
+
+    for (int it = 0; it < BENCH_FUZZ; ++it) {
+        std::string text = documents[it & 1];
+        for (int edits = 1 + rng() % 3; edits > 0; --edits) {
+            size_t pos = rng() % text.size();
+            char c = BENCH_ALPHABET[rng() % (sizeof(BENCH_ALPHABET) - 1)];
+            switch (rng() % 3) {
+                case 0: text[pos] = c; break;
+                case 1: text.erase(pos, 1); break;
+                default: text.insert(pos, 1, c); break;
+            }
+        }
+
+        bool expected = nlohmann::json::accept(text);
+        json_value root = json_validate(text);
+        if (expected != (root.type != JSON_NONE)) {
+            if (bad++ < 10) printf("MISMATCH nlohmann=%d ondemand=%d: %s\n", expected, !expected, text.c_str());
+            continue;
+        }
+        if (!expected || root.type != JSON_OBJECT) {
+            continue;
+        }
+
+        nlohmann::json dom = nlohmann::json::parse(text);
+        for (const char *key : {"error", "token"}) {
+            std::string value;
+            if (dom.contains(key) && dom[key].is_string() &&
+                (!json_get_string(json_find(root, key), &value) || value != dom[key].get<std::string>())) {
+                if (bad++ < 10) printf("DECODE MISMATCH on \"%s\": %s\n", key, text.c_str());
+            }
+        }
+    }
+    return bad;
+}
+
+/**
+ * Benchmarks the on-demand reader against nlohmann::json::parse on book
+ * lists of 1K to 1M books: reading the fields get_books prints, and only
+ * classifying the reply (the "error" lookup every handler does).
+ */
+int main() {
+    int bad = check();
+    printf("correctness: %s (%d mutated documents)\n", bad ? "FAIL" : "ok", BENCH_FUZZ);
+    if (bad) {
+        return 1;
+    }
+
+    auto ms = [](auto start, auto stop, int reps) {
+        return std::chrono::duration<double, std::milli>(stop - start).count() / reps;
+    };
+
+    for (size_t books : {1000, 10000, 100000, 1000000}) {
+        std::string text = bench_catalog(books);
+        int reps = books >= 1000000 ? 3 : (int)(3000000 / books);
+        size_t sink = 0;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            nlohmann::json dom = nlohmann::json::parse(text);
+            for (const nlohmann::json &book : dom) {
+                sink += book["id"].get<long>() + book["title"].get_ref<const std::string &>().size() +
+                        book["author"].get_ref<const std::string &>().size();
+            }
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            json_iter iter = json_iter_init(json_validate(text));
+            json_value book;
+            std::string value;
+            while (json_iter_next(&iter, NULL, &book)) {
+                sink += json_find(book, "id").size;
+                json_get_string(json_find(book, "title"), &value);
+                sink += value.size();
+                json_get_string(json_find(book, "author"), &value);
+                sink += value.size();
+            }
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            nlohmann::json dom = nlohmann::json::parse(text);
+            sink += dom.is_object() && dom.contains("error");
+        }
+
+        auto t3 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            sink += json_find(json_validate(text), "error").size;
+        }
+        auto t4 = std::chrono::steady_clock::now();
+
+        printf("%8zu books (%6.1f MB): fields nlohmann %8.2f ms, ondemand %7.2f ms (x%.1f) | "
+               "classify nlohmann %8.2f ms, ondemand %7.2f ms (x%.1f) (%zu)\n",
+               books, text.size() / 1e6, ms(t0, t1, reps), ms(t1, t2, reps), ms(t0, t1, reps) / ms(t1, t2, reps),
+               ms(t2, t3, reps), ms(t3, t4, reps), ms(t2, t3, reps) / ms(t3, t4, reps), sink % 10);
+    }
+    return 0;
+}
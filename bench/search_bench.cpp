@@ -0,0 +1,135 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "../src/utils/search.hpp"
+
+// Bytes of the haystack searched
+#define BENCH_HAYSTACK (8 << 20)
+
+// Passes over the haystack per measurement
+#define BENCH_PASSES 10
+
+// Random haystack/needle pairs checked against the reference functions
+#define BENCH_CHECKS 20000
+
+typedef long (*find_fn)(const char *, size_t, const char *, size_t);
+
+/**
+ * The buffer_find() kernel the vectorized one replaced: memcmp() at every
+ * offset.
+ */
+static long reference_find(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size > size) return -1;
+
+    size_t last_pos = size - needle_size + 1;
+    for (size_t i = 0; i < last_pos; ++i) {
+        if (memcmp(haystack + i, needle, needle_size) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * The buffer_find_insensitive() kernel the vectorized one replaced:
+ * tolower() on every byte pair.
+ */
+static long reference_find_insensitive(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size > size) return -1;
+
+    size_t last_pos = size - needle_size + 1;
+    for (size_t i = 0; i < last_pos; ++i) {
+        size_t j;
+        for (j = 0; j < needle_size; ++j) {
+            if (tolower(haystack[i + j]) != tolower(needle[j])) {
+                break;
+            }
+        }
+        if (j == needle_size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Checks the vectorized kernels against the reference ones on short
+ * random haystacks, with needles taken from them in either case.
+ * @param text Random text to draw from.
+ * @param rng The random generator.
+ * @return false on the first disagreement.
+ */
+static bool check(const std::string &text, std::mt19937 *rng) {
+    for (int t = 0; t < BENCH_CHECKS; ++t) {
+        std::string haystack = text.substr((*rng)() % 1000, (*rng)() % 300);
+        size_t needle_size = 1 + (*rng)() % 6;
+        if (needle_size > haystack.size()) {
+            continue;
+        }
+
+        std::string needle = haystack.substr((*rng)() % (haystack.size() - needle_size + 1), needle_size);
+        if ((*rng)() % 2) {
+            for (char &c : needle) c = (char)toupper(c);
+        }
+
+        const char *h = haystack.data();
+        const char *n = needle.data();
+        if (search_find(h, haystack.size(), n, needle_size) != reference_find(h, haystack.size(), n, needle_size) ||
+            search_find_insensitive(h, haystack.size(), n, needle_size) !=
+                reference_find_insensitive(h, haystack.size(), n, needle_size)) {
+            printf("MISMATCH on \"%s\" in \"%s\"\n", needle.c_str(), haystack.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Measures a kernel searching the haystack for a needle it does not hold,
+ * so every byte is scanned.
+ * @param name The kernel name.
+ * @param find The kernel.
+ * @param haystack The haystack.
+ */
+static void measure(const char *name, find_fn find, const std::string &haystack) {
+    const char *needle = "Content-Length: ";
+    long sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+        sink += find(haystack.data(), haystack.size(), needle, strlen(needle));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-32s %6.2f GB/s (%ld)\n", name, (double)BENCH_PASSES * haystack.size() / seconds / 1e9, sink);
+}
+
+/**
+ * Benchmarks search_find() and search_find_insensitive() against the
+ * scalar kernels they replaced, on random JSON-like text.
+ */
+int main() {
+    const char *alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\":,{}[] \r\n";
+    size_t letters = strlen(alphabet);
+
+    std::mt19937 rng(1);
+    std::string haystack(BENCH_HAYSTACK, ' ');
+    for (char &c : haystack) {
+        c = alphabet[rng() % letters];
+    }
+
+    if (!check(haystack, &rng)) {
+        return 1;
+    }
+    printf("correctness: ok (%d random searches)\n", BENCH_CHECKS);
+
+    measure("buffer_find (scalar)", reference_find, haystack);
+    measure("search_find", search_find, haystack);
+    measure("buffer_find_insensitive (scalar)", reference_find_insensitive, haystack);
+    measure("search_find_insensitive", search_find_insensitive, haystack);
+    return 0;
+}
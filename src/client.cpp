@@ -9,42 +9,84 @@
 #include "include/books/get_books.hpp"
 #include "include/books/add_book.hpp"
 #include "include/books/del_book.hpp"
+#include "include/books/search_books.hpp"
+#include "include/books/diff_books.hpp"
+#include "include/books/export_books.hpp"
+#include "include/books/dedupe_books.hpp"
+
+#include "include/stats.hpp"
+
+/**
+ * @param cmd A command name.
+ * @return true if the command takes an argument on its own line (e.g., "search dune").
+ */
+static bool takesArgument(const std::string &cmd)
+{
+    return cmd == "search" || cmd == "get_books" || cmd == "stats" || cmd == "diff" || cmd == "export";
+}
 
 int main(void)
 {
     std::string cmd;
-    char *conn = (char *)IP_SERVER;
+    session session = session_init(IP_SERVER);
+
+    catalog catalog = catalog_init();
+    catalog_memo memo = {0, 0, 0, 0};
+    trigram_index index = trigram_init();
 
-    int sockfd;
+    reply_cache cache;
+    cache_init(&cache, BOOK_CACHE_CAPACITY, BOOK_CACHE_TTL_MS);
+
+    int sockfd = -1;
     bool log = false;
     bool enter = false;
 
     std::string reply;
-    std::string cookie;
-    std::string jwt;
 
     while (cmd != "exit") {
         getline(std::cin, cmd);
 
+        // JSON values built by the command are allocated here and freed all at once
+        command_arena arena;
+
         cmd = httpMessageTrim(cmd); // Trim leading and trailing whitespace from the command
+
+        // Split the argument off the command name, it keeps its case
+        std::string arg;
+        size_t space = cmd.find(' ');
+        if (space != std::string::npos) {
+            arg = httpMessageTrim(cmd.substr(space + 1));
+            cmd.resize(space);
+        }
+
         std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c) { 
             return std::tolower(c);  // Convert the command to lowercase for easier comparison 
         });
 
-        sockfd = openConnection(conn, PORT_HTTP, AF_INET, SOCK_STREAM, 0);
-
-        if (cmd == "register") register_credentials(conn, sockfd, log, reply);
-        else if (cmd == "login") login(conn, sockfd, log, reply, cookie);
-        else if (cmd == "logout") logout(conn, sockfd, log, enter, jwt, reply, cookie);
-        else if (cmd == "enter_library") enter_library(conn, sockfd, log, enter, jwt, reply, cookie);
-        else if (cmd == "get_book") get_book(conn, sockfd, log, enter, jwt, reply);
-        else if (cmd == "get_books") get_books(conn, sockfd, log, enter, jwt, reply);
-        else if (cmd == "add_book") add_book(conn, sockfd, log, enter, jwt, reply);
-        else if (cmd == "delete_book") del_book(conn, sockfd, log, enter, jwt, reply);
+        if (!arg.empty() && !takesArgument(cmd)) std::cout << "INVALID REQUEST SEND!" << std::endl;
+        else if (cmd == "register") register_credentials(session, sockfd, log, reply);
+        else if (cmd == "login") login(session, sockfd, log, reply);
+        else if (cmd == "logout") logout(session, sockfd, log, enter, cache, catalog, memo, index, reply);
+        else if (cmd == "enter_library") enter_library(session, sockfd, log, enter, cache, catalog, memo, reply);
+        else if (cmd == "get_book") get_book(session, sockfd, log, enter, cache, catalog, reply);
+        else if (cmd == "get_books") get_books(session, sockfd, log, enter, cache, catalog, memo, reply, arg);
+        else if (cmd == "add_book") add_book(session, sockfd, log, enter, cache, catalog, memo, index, reply);
+        else if (cmd == "delete_book") del_book(session, sockfd, log, enter, cache, catalog, memo, index, reply);
+        else if (cmd == "search") search_books(catalog, memo, index, arg);
+        else if (cmd == "diff") diff_books(catalog, arg);
+        else if (cmd == "export") export_books(catalog, arg);
+        else if (cmd == "dedupe") dedupe_books(catalog);
+        else if (cmd == "stats") stats(cache, catalog, memo, arg);
         else if (cmd != "exit") std::cout << "INVALID REQUEST SEND!" << std::endl;
 
-        closeConnection(sockfd);
+        // Keep the connection alive for the next command (if one was opened)
+        if (sockfd >= 0) {
+            connectionRelease(sockfd);
+            sockfd = -1;
+        }
     }
 
+    revalidateWait();
+    connectionPoolClear();
     return EXIT_SUCCESS;
 }
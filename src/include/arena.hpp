@@ -0,0 +1,84 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "../lib/json.hpp"
+
+// Bytes of the block every command arena starts from, reused across commands
+#define ARENA_INITIAL (64 * 1024)
+
+// Resource arena_allocator draws from: the command arena while a command
+// runs, the global heap otherwise
+std::pmr::memory_resource *arena_resource = std::pmr::new_delete_resource();
+
+/**
+ * Allocator drawing from the current command arena. It carries no state,
+ * because nlohmann::json default-constructs its allocator wherever it
+ * needs one; memory must therefore be released before the arena that
+ * provided it goes away, which holds for values local to a command.
+ */
+template <typename T>
+struct arena_allocator {
+    typedef T value_type;
+
+    arena_allocator() = default;
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(arena_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        arena_resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const arena_allocator<U> &) const { return false; }
+};
+
+// String whose characters live in the command arena
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+// JSON value whose nodes, strings and arrays all live in the command arena
+typedef nlohmann::basic_json<std::map, std::vector, arena_string, bool, std::int64_t,
+                             std::uint64_t, double, arena_allocator> arena_json;
+
+/**
+ * Monotonic arena for the JSON values built while one command runs.
+ * Allocations are carved from a block reused by every command, spilling
+ * into a few growing heap chunks when it is full; frees are no-ops, and
+ * everything is released at once when the command ends. Only one arena
+ * may be live at a time, since they share the initial block.
+ */
+class command_arena {
+public:
+    command_arena() : resource(initial, sizeof(initial), std::pmr::new_delete_resource()),
+                      previous(arena_resource) {
+        arena_resource = &resource;
+    }
+
+    ~command_arena() {
+        arena_resource = previous;
+    }
+
+    command_arena(const command_arena &) = delete;
+    command_arena &operator=(const command_arena &) = delete;
+
+private:
+    alignas(std::max_align_t) static char initial[ARENA_INITIAL];
+    std::pmr::monotonic_buffer_resource resource;
+    std::pmr::memory_resource *previous;
+};
+
+alignas(std::max_align_t) char command_arena::initial[ARENA_INITIAL];
+
+#endif /* ARENA_HPP */
@@ -2,18 +2,24 @@
 #define ADD_BOOK
 
 #include "../response.hpp"
+#include "book.hpp"
+#include "kept_books.hpp"
 
 /**
  * Adds a new book to the library system.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has entered the library.
- * @param jwt    JWT token for authentication.
+ * @param cache  Cached replies, the copy of the book list is dropped from it.
+ * @param catalog The last book list, dropped along with its memo, index and snapshot.
+ * @param memo   Size and hash of the body `catalog` was parsed from.
+ * @param index  Trigram index over `catalog`.
  * @param reply  Reference to a string where the server response will be stored.
  */
-void add_book(char* conn, int& sockfd, bool& login, bool& enter, std::string& jwt, std::string& reply)
+void add_book(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+              catalog &catalog, catalog_memo &memo, trigram_index &index, std::string &reply)
 {
     // Check if the user is logged in
     if (!login) {
@@ -27,76 +33,67 @@ void add_book(char* conn, int& sockfd, bool& login, bool& enter, std::string& jw
         return;
     }
 
-    nlohmann::json json;
+    book book;
 
     // Get book details from the user
-    std::string title;
     std::cout << TITLE;
-    std::getline(std::cin >> std::ws, title);
-    json["title"] = title;
+    std::getline(std::cin >> std::ws, book.title);
 
-    std::string author;
     std::cout << AUTHOR;
-    std::getline(std::cin >> std::ws, author);
-    json["author"] = author;
+    std::getline(std::cin >> std::ws, book.author);
 
-    std::string genre;
     std::cout << GENRE;
-    std::getline(std::cin >> std::ws, genre);
-    json["genre"] = genre;
+    std::getline(std::cin >> std::ws, book.genre);
 
     // Validate page count (must be an integer)
-    std::string page_count;
     std::cout << PAGE_COUNT;
-    std::getline(std::cin >> std::ws, page_count);
+    std::getline(std::cin >> std::ws, book.page_count);
 
     // Check if the page count is a valid integer
-    for (char c : page_count) {
+    for (char c : book.page_count) {
         if (!std::isdigit(c)) {
             std::cout << "ERROR: Page count must be an integer!" << std::endl;
             return;
         }
     }
-    json["page_count"] = page_count;
 
-    std::string publisher;
     std::cout << PUBLISHER;
-    std::getline(std::cin >> std::ws, publisher);
-    json["publisher"] = publisher;
+    std::getline(std::cin >> std::ws, book.publisher);
 
-    // Convert the JSON object to a string representation
-    std::string jsonStr = json.dump(); 
-    size_t jsonLength = jsonStr.length(); 
+    // Serialize the book through its schema
+    std::string jsonStr;
+    schema_serialize(BOOK_SCHEMA, book, &jsonStr);
 
     // Construct and send the POST request to add the book
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - BOOKS: The endpoint URL for adding a new book.
-    // - jwt: The authentication token required for authorization.
     // - APP: The content type (usually "application/json").
-    // - jsonStr.c_str(): The serialized JSON payload.
-    // - jsonLength: The length of the JSON string.
-    // - {}: No additional headers.
-    // - 0: No extra data.
-    std::string message = POST(conn, BOOKS, jwt, APP, jsonStr.c_str(), jsonLength, {}, 0);
-    sendServerMessage(sockfd, message);
-
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
-
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
-    bool isJsonResponseEmpty = jsonResponse.empty();
+    // - jsonStr: The serialized JSON payload.
+    std::string message = POST(session, BOOKS, APP, jsonStr);
+
+    // A revalidation still running could store its copy after the one
+    // dropped below, so let them all finish first
+    revalidateWait();
+
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
+
+    // The list changes with the new book, its copy must be fetched again
+    discardCatalog(session, cache, catalog, memo, index);
+
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // If no JSON response is present, assume book was added successfully
-    if (isJsonResponseEmpty) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << reply << " - Book successfully added." << std::endl;
         return;
     }
 
     // Handle potential errors returned by the server
-    errorJSONReply(jsonResponse, reply);
+    errorJSONReply(decoded, reply);
 }
 
 #endif /* ADD_BOOK */
@@ -0,0 +1,42 @@
+#ifndef BOOK_HPP
+#define BOOK_HPP
+
+#include "../schema.hpp"
+
+// Book record, as exchanged with the server
+typedef struct {
+    std::string author;
+    std::string genre;
+    std::string id;          // assigned by the server
+    std::string page_count;
+    std::string publisher;
+    std::string title;
+} book;
+
+// Field numbers of BOOK_SCHEMA
+enum {
+    BOOK_AUTHOR,
+    BOOK_GENRE,
+    BOOK_ID,
+    BOOK_PAGE_COUNT,
+    BOOK_PUBLISHER,
+    BOOK_TITLE
+};
+
+// Book fields in key order, so add_book sends the same payload
+// nlohmann::json::dump() produced. page_count stays a JSON string,
+// the type the server has always received it as.
+constexpr schema_field<book> BOOK_FIELDS[] = {
+    {"author",     FIELD_STRING, false, &book::author},
+    {"genre",      FIELD_STRING, false, &book::genre},
+    {"id",         FIELD_NUMBER, true,  &book::id},
+    {"page_count", FIELD_STRING, false, &book::page_count},
+    {"publisher",  FIELD_STRING, false, &book::publisher},
+    {"title",      FIELD_STRING, false, &book::title},
+};
+
+constexpr record_schema<book, 6> BOOK_SCHEMA(BOOK_FIELDS);
+
+static_assert(BOOK_SCHEMA.fields[BOOK_TITLE].member == &book::title, "field numbers out of sync with BOOK_FIELDS");
+
+#endif /* BOOK_HPP */
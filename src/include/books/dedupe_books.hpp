@@ -0,0 +1,59 @@
+#ifndef DEDUPE_BOOKS
+#define DEDUPE_BOOKS
+
+#include "../response.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/dedupe.hpp"
+
+/**
+ * Reports the books of the catalog kept from the last get_books that
+ * look like duplicates of each other (e.g. the same book added twice
+ * with a slightly different title or publisher), as clusters of
+ * candidates for a librarian to check. Nothing is sent to the server.
+ *
+ * @param catalog The book list checked.
+ */
+void dedupe_books(const catalog &catalog)
+{
+    if (catalog.count == 0) {
+        std::cout << "ERROR: No books kept yet, run get_books first!" << std::endl;
+        return;
+    }
+
+    std::vector<std::vector<uint32_t>> clusters;
+    dedupe_clusters(&catalog, 0, &clusters);
+
+    if (clusters.empty()) {
+        std::cout << "No duplicate books found." << std::endl;
+        return;
+    }
+
+    size_t books = 0;
+    for (const std::vector<uint32_t> &cluster : clusters) {
+        books += cluster.size();
+    }
+    std::cout << "Found " << clusters.size() << (clusters.size() == 1 ? " cluster" : " clusters")
+              << " of possible duplicates (" << books << " books):\n";
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        std::cout << "Cluster " << c + 1 << " (" << clusters[c].size() << " books):\n";
+        for (uint32_t i : clusters[c]) {
+            std::string_view title = catalog_title(&catalog, i);
+            std::string_view author = catalog_author(&catalog, i);
+            std::string_view publisher = catalog_publisher(&catalog, i);
+
+            std::cout << "- ID: ";
+            if (catalog.ids[i] < 0) {
+                std::cout << "N/A";
+            } else {
+                std::cout << catalog.ids[i];
+            }
+            std::cout << ", Title: " << (title.empty() ? "Unknown" : title)
+                      << ", Author: " << (author.empty() ? "Unknown" : author)
+                      << ", Publisher: " << (publisher.empty() ? "Unknown" : publisher) << '\n';
+        }
+    }
+    std::cout << std::flush;
+}
+
+#endif /* DEDUPE_BOOKS */
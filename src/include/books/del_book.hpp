@@ -2,18 +2,23 @@
 #define DEL_BOOK
 
 #include "../response.hpp"
+#include "kept_books.hpp"
 
 /**
  * Deletes a book from the library system.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has entered the library.
- * @param jwt    JWT token for authentication.
+ * @param cache  Cached replies, the deleted book and the book list are dropped from it.
+ * @param catalog The last book list, dropped along with its memo, index and snapshot.
+ * @param memo   Size and hash of the body `catalog` was parsed from.
+ * @param index  Trigram index over `catalog`.
  * @param reply  Reference to a string where the server response will be stored.
  */
-void del_book(char *conn, int &sockfd, bool &login, bool &enter, std::string &jwt, std::string &reply)
+void del_book(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+              catalog &catalog, catalog_memo &memo, trigram_index &index, std::string &reply)
 {
     // Check if the user is logged in
     if (!login) {
@@ -45,34 +50,36 @@ void del_book(char *conn, int &sockfd, bool &login, bool &enter, std::string &jw
     std::string book_id = BOOKS + std::to_string(id);
 
     // Construct the DELETE request
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - book_id: The endpoint URL for deleting a specific book.
-    // - jwt: The authentication token required for authorization.
-    // - NO_TOKEN: No additional cookies or authorization headers needed.
-    // - NO_TOKEN: No additional session tokens used.
-    // - 0: No additional headers.
-    // - {}: Empty list of headers (since DELETE requests typically require only authentication).
-    // - 0: No body content, as DELETE requests generally do not include a request payload.
-    std::string message = DELETE(conn, book_id, jwt, NO_TOKEN, NO_TOKEN, 0, {}, 0);
-    sendServerMessage(sockfd, message);
+    // - NO_CONTENT_TYPE: No content type, since there is no payload.
+    // - "": No body content, as DELETE requests generally do not include a request payload.
+    std::string message = DELETE(session, book_id, NO_CONTENT_TYPE, "");
 
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
+    // A revalidation still running could store its copy after the one
+    // dropped below, so let them all finish first
+    revalidateWait();
 
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
-    bool isJsonResponseEmpty = jsonResponse.empty();
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
+
+    // Whatever the outcome, the cached copies can no longer be trusted
+    cache_invalidate(&cache, id);
+    discardCatalog(session, cache, catalog, memo, index);
+
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // If no JSON response is present, assume deletion was successful
-    if (isJsonResponseEmpty) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << reply << " - Book successfully deleted." << std::endl;
         return;
     }
 
     // Handle potential errors returned by the server
-    errorJSONReply(jsonResponse, reply);
+    errorJSONReply(decoded, reply);
 }
 
 #endif /* DEL_BOOK */
@@ -0,0 +1,99 @@
+#ifndef DIFF_BOOKS
+#define DIFF_BOOKS
+
+#include "../response.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/diff.hpp"
+#include "../../utils/query.hpp"
+#include "../../utils/snapshot.hpp"
+
+// The two catalogs a diff prints books from
+typedef struct {
+    const catalog *before;
+    const catalog *after;
+} diff_catalogs;
+
+/**
+ * Prints a book that differs between two catalogs: `+` added, `-`
+ * removed, `~` modified, followed by the fields that changed.
+ *
+ * @param context The diff_catalogs compared.
+ * @param change  The book.
+ */
+void printDiffChange(void *context, const diff_change *change)
+{
+    const diff_catalogs *catalogs = (const diff_catalogs *)context;
+    const catalog *list = change->after >= 0 ? catalogs->after : catalogs->before;
+    size_t i = change->after >= 0 ? change->after : change->before;
+
+    std::string_view title = catalog_title(list, i);
+    std::string_view author = catalog_author(list, i);
+
+    std::cout << (change->kind == DIFF_ADDED ? "+ ID: " : change->kind == DIFF_REMOVED ? "- ID: " : "~ ID: ");
+    if (change->id < 0) {
+        std::cout << "N/A";
+    } else {
+        std::cout << change->id;
+    }
+    std::cout << ", Title: " << (title.empty() ? "Unknown" : title)
+              << ", Author: " << (author.empty() ? "Unknown" : author);
+
+    if (change->kind == DIFF_MODIFIED) {
+        const char *separator = " (changed: ";
+        for (int field = 0; field < QUERY_FIELDS; ++field) {
+            if (change->fields & (1u << field)) {
+                std::cout << separator << query_field_name(field);
+                separator = ", ";
+            }
+        }
+        std::cout << ')';
+    }
+    std::cout << '\n';
+}
+
+/**
+ * Compares the catalog kept from the last get_books with one saved in a
+ * snapshot file (e.g. a copy of catalog.snapshot), and prints the books
+ * added, removed and modified since, in id order. Nothing is sent to
+ * the server.
+ *
+ * @param catalog The current book list, indexed by id first if needed.
+ * @param path    The snapshot file, prompted for if empty.
+ */
+void diff_books(catalog &catalog, std::string path)
+{
+    // Prompt the user for the file if it was not given with the command
+    if (path.empty()) {
+        std::cout << "Enter the snapshot file: ";
+        std::getline(std::cin >> std::ws, path);
+    }
+
+    if (catalog.count == 0) {
+        std::cout << "ERROR: No books kept yet, run get_books first!" << std::endl;
+        return;
+    }
+
+    ::catalog saved = catalog_init();
+    catalog_memo memo = {0, 0, 0, 0};
+    cache_validators validators = cache_validators_init();
+    if (!snapshot_load(path.c_str(), &saved, &memo, &validators)) {
+        std::cout << "ERROR: Cannot read the snapshot " << path << "!" << std::endl;
+        return;
+    }
+
+    // Both sides are walked in id order
+    if (catalog.id_order.size() != catalog.count) {
+        catalog_index(&catalog);
+    }
+    if (saved.id_order.size() != saved.count) {
+        catalog_index(&saved);
+    }
+
+    diff_catalogs catalogs = {&saved, &catalog};
+    diff_counts counts = catalog_diff(&saved, &catalog, printDiffChange, &catalogs);
+
+    std::cout << "Since " << path << ": " << counts.added << " added, " << counts.removed << " removed, "
+              << counts.modified << " modified, " << counts.unchanged << " unchanged." << std::endl;
+}
+
+#endif /* DIFF_BOOKS */
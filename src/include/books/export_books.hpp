@@ -0,0 +1,59 @@
+#ifndef EXPORT_BOOKS
+#define EXPORT_BOOKS
+
+#include <sstream>
+
+#include "../response.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/export.hpp"
+
+/**
+ * Writes the catalog kept from the last get_books to a file other tools
+ * can map and scan without parsing (see src/utils/export.hpp for the
+ * layout). Nothing is sent to the server.
+ *
+ * @param catalog The book list exported.
+ * @param args    `--format=columnar <file>`; the format is optional, the
+ *                file is prompted for if left out.
+ */
+void export_books(const catalog &catalog, const std::string &args)
+{
+    // Split the options from the file name
+    std::string path;
+    std::istringstream words(args);
+    for (std::string word; words >> word;) {
+        if (word.rfind("--format=", 0) == 0) {
+            if (word != "--format=columnar") {
+                std::cout << "ERROR: The only export format is columnar!" << std::endl;
+                return;
+            }
+        } else if (path.empty()) {
+            path = word;
+        } else {
+            std::cout << "ERROR: Give a single export file!" << std::endl;
+            return;
+        }
+    }
+
+    // Prompt the user for the file if it was not given with the command
+    if (path.empty()) {
+        std::cout << "Enter the export file: ";
+        std::getline(std::cin >> std::ws, path);
+    }
+
+    if (catalog.count == 0) {
+        std::cout << "ERROR: No books kept yet, run get_books first!" << std::endl;
+        return;
+    }
+
+    size_t size = export_columnar(path.c_str(), &catalog);
+    if (size == 0) {
+        std::cout << "ERROR: Cannot write " << path << "!" << std::endl;
+        return;
+    }
+
+    std::cout << "Exported " << catalog.count << (catalog.count == 1 ? " book" : " books")
+              << " to " << path << " (" << size << " bytes)." << std::endl;
+}
+
+#endif /* EXPORT_BOOKS */
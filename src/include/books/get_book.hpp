@@ -2,18 +2,55 @@
 #define GET_BOOK
 
 #include "../response.hpp"
+#include "../../utils/catalog.hpp"
+
+/**
+ * Prints a book kept in the catalog, in the layout of the server's reply.
+ *
+ * @param catalog The book list.
+ * @param id      The book ID.
+ * @return false if the book is not in the catalog, or only partly (lists may leave fields out).
+ */
+bool printCatalogBook(const catalog &catalog, long id)
+{
+    long row = catalog_find(&catalog, id);
+    if (row < 0) {
+        return false;
+    }
+
+    std::string_view title = catalog_title(&catalog, row);
+    std::string_view author = catalog_author(&catalog, row);
+    std::string_view genre = catalog_genre(&catalog, row);
+    std::string_view publisher = catalog_publisher(&catalog, row);
+    long page_count = catalog.page_counts[row];
+    if (title.empty() || author.empty() || genre.empty() || publisher.empty() || page_count < 0) {
+        return false;
+    }
+
+    arena_json book;
+    book["author"] = arena_string(author);
+    book["genre"] = arena_string(genre);
+    book["id"] = id;
+    book["page_count"] = page_count;
+    book["publisher"] = arena_string(publisher);
+    book["title"] = arena_string(title);
+    std::cout << "Book details: " << book.dump(4) << std::endl;
+    return true;
+}
 
 /**
  * Retrieves details of a specific book from the library system.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has entered the library.
- * @param jwt    JWT token for authentication.
+ * @param cache  Replies of recent lookups, answered without a request while fresh.
+ * @param catalog The last book list, answering for books not cached yet while it is fresh.
  * @param reply  Reference to a string where the server response will be stored.
  */
-void get_book(char *conn, int &sockfd, bool &login, bool &enter, std::string &jwt, std::string &reply)
+void get_book(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+              const catalog &catalog, std::string &reply)
 {
     // Check if the user is logged in
     if (!login) {
@@ -44,45 +81,95 @@ void get_book(char *conn, int &sockfd, bool &login, bool &enter, std::string &jw
     int id = std::stoi(input);
     std::string book_id = BOOKS + std::to_string(id);
 
-    // Create and send the GET request to retrieve book details
-    // - conn: The server connection details.
-    // - book_id: The API endpoint for fetching book details.
-    // - NO_TOKEN: No additional authorization token needed.
-    // - jwt: Authentication token required for authorization.
-    // - {}: No additional headers.
-    // - 0: No extra parameters.
-    std::string message = GET(conn, book_id, NO_TOKEN, jwt, {}, 0);
-    sendServerMessage(sockfd, message);
-
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
-
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
-    bool isJsonResponseEmpty = jsonResponse.empty();
+    // Answer from the cache if the book was fetched recently; a stale
+    // copy is answered at once and revalidated in the background
+    http_response response;
+    std::string cached;
+    std::string_view body;
+    cache_validators validators;
+    cache_state state = cache_get(&cache, id, &reply, &cached, &validators);
+    bool hit = state == CACHE_FRESH || state == CACHE_STALE;
+
+    if (state == CACHE_STALE) {
+        revalidateInBackground(session, cache, id, book_id, validators);
+    }
+
+    // Not cached, but the catalog holds the whole book and is itself fresh
+    // (a write drops it, and a snapshot loaded on entry never is): answer
+    // from it at once, and fetch the server's copy in the background for
+    // the next lookup
+    if (state == CACHE_MISS && cache_fresh(&cache, BOOK_LIST_KEY) && printCatalogBook(catalog, id)) {
+        reply = "200";
+        revalidateInBackground(session, cache, id, book_id, cache_validators_init());
+        return;
+    }
+
+    if (hit) {
+        body = cached;
+    } else {
+        // Create and send the GET request to retrieve book details
+        // - session: The server host and credentials, as pre-serialized headers.
+        // - book_id: The API endpoint for fetching book details.
+        // - NO_QUERRY: No query parameters needed.
+        // - validators: Those of an expired copy, so an unchanged book is answered with 304.
+        std::string message = state == CACHE_REVALIDATE
+                            ? GET(session, book_id, NO_QUERRY, validators.etag, validators.last_modified)
+                            : GET(session, book_id, NO_QUERRY);
+
+        // Send the request and receive the server's response
+        extractServerResponse(response, session, sockfd, message);
+        validators = extractValidators(response);
+
+        // 304 Not Modified: the expired copy is still current, unless its
+        // entry is gone meanwhile (dropped by a failed revalidation in the
+        // background, e.g. the book was deleted); then nothing vouches for
+        // the copy any more, so the book is fetched again
+        if (response.status == 304 && !cache_refresh(&cache, id, &validators)) {
+            extractServerResponse(response, session, sockfd, GET(session, book_id, NO_QUERRY));
+            validators = extractValidators(response);
+        }
+
+        hit = response.status == 304;
+        if (hit) {
+            body = cached;
+        } else {
+            reply = response.code;
+            body = response.body;
+        }
+    }
+
+    // Decode the JSON content (if any)
+    decoded_response decoded = decodeResponse(body);
 
     // If no JSON response is present, indicate an unknown issue
-    if (isJsonResponseEmpty) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << "ERROR: Unknown problem occurred!" << std::endl;
         return;
     }
 
-    // Parse the JSON response
-    nlohmann::json responseJSON = nlohmann::json::parse(jsonResponse);
-    bool isJSONerror = responseJSON.contains("error");
+    // Display the book details if no error is found; every field is
+    // printed here, so this is the one place a full DOM is built (in the
+    // command arena). The body was validated as strictly as the DOM parser
+    // checks it, so a failure here is a bug, never a reply to cache
+    if (decoded.kind == DECODE_SUCCESS) {
+        arena_json book;
+        try {
+            book = arena_json::parse(decoded.json.data, decoded.json.data + decoded.json.size);
+        } catch (const nlohmann::json::exception &e) {
+            decoded.kind = DECODE_INVALID;
+            errorJSONReply(decoded, reply);
+            return;
+        }
 
-    // Display the book details if no error is found
-    if (!isJSONerror) {
-        std::cout << "Book details: " << responseJSON.dump(4) << std::endl; // Pretty-print JSON
-    } else {
-        // Display the error message returned by the server
-        std::cout << "ERROR: " << reply << " <=> " << responseJSON["error"].get<std::string>() << std::endl;
+        if (!hit) {
+            cache_put(&cache, id, reply, body, &validators);
+        }
+        std::cout << "Book details: " << book.dump(4) << std::endl; // Pretty-print JSON
+        return;
     }
 
     // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
+    errorJSONReply(decoded, reply);
 }
 
 #endif /* GET_BOOK */
@@ -2,18 +2,241 @@
 #define GET_BOOKS
 
 #include "../response.hpp"
+#include "book.hpp"
+#include "kept_books.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/snapshot.hpp"
+#include "../../utils/query.hpp"
 
 /**
- * Retrieves a list of all books available in the library system.
+ * SAX handler printing a book list as it is parsed. Keys are dispatched
+ * through BOOK_SCHEMA, values are written straight into a reused book
+ * record, and each line is written as soon as its object closes, so no
+ * DOM of the list is ever built; each book is also appended to a catalog.
+ * Books are only kept, not printed, when a query is to select them after.
+ */
+class book_printer : public nlohmann::json_sax<nlohmann::json> {
+public:
+    book_printer(catalog *list, bool echo) : list(list), echo(echo) {}
+
+    size_t books = 0;         // books printed so far
+    bool is_list = false;     // the top-level value is an array
+    bool failed = false;      // the body is not valid JSON
+    std::string error;        // "error" member of a top-level object
+
+    bool null() override { return value(""); }
+    bool boolean(bool val) override { return value(val ? "true" : "false"); }
+    bool number_integer(number_integer_t val) override { return value(std::to_string(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return value(std::to_string(val)); }
+    bool number_float(number_float_t, const string_t &s) override { return value(s); }
+    bool string(string_t &val) override { return value(val); }
+    bool binary(binary_t &) override { return value(""); }
+
+    bool start_object(std::size_t) override {
+        if (++depth == 2 && is_list) {
+            present = 0;
+        }
+        field = NULL;
+        return true;
+    }
+
+    bool key(string_t &val) override {
+        field = NULL;
+        if (depth == 2 && is_list) {
+            int number = BOOK_SCHEMA.find(val);
+            if (number >= 0) {
+                field = &(current.*BOOK_SCHEMA.fields[number].member);
+                present |= 1u << number;
+            }
+        } else if (depth == 1 && !is_list && val == "error") {
+            field = &error;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth-- == 2 && is_list) {
+            // Print the header with the first book, so an empty list prints nothing here
+            if (books++ == 0 && echo) {
+                std::cout << "List of books:\n";
+            }
+            if (echo) {
+                std::cout << "- ID: " << text(BOOK_ID, "N/A")
+                          << ", Title: " << text(BOOK_TITLE, "Unknown")
+                          << ", Author: " << text(BOOK_AUTHOR, "Unknown") << '\n';
+            }
+
+            catalog_entry entry = {number(BOOK_ID), text(BOOK_TITLE, ""), text(BOOK_AUTHOR, ""),
+                                   text(BOOK_GENRE, ""), text(BOOK_PUBLISHER, ""), number(BOOK_PAGE_COUNT)};
+            catalog_add(list, &entry);
+        }
+        field = NULL;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (++depth == 1) {
+            is_list = true;
+        }
+        field = NULL;
+        return true;
+    }
+
+    bool end_array() override {
+        --depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &) override {
+        failed = true;
+        return false;
+    }
+
+private:
+    catalog *list;              // filled with every book printed
+    bool echo;                  // print each book as it is parsed
+    int depth = 0;              // nesting of the value being parsed
+    std::string *field = NULL;  // where the next scalar value goes, if kept
+    book current;               // book being parsed, its strings are reused
+    unsigned present = 0;       // fields of `current` seen, by field number
+
+    // Stores a scalar in the field named by the last key, if it is kept
+    bool value(const std::string &val) {
+        if (field != NULL) {
+            *field = val;
+            field = NULL;
+        }
+        return true;
+    }
+
+    // A field of the current book, or fallback if the server did not send it
+    std::string_view text(int number, std::string_view fallback) const {
+        return (present & (1u << number)) ? std::string_view(current.*BOOK_SCHEMA.fields[number].member) : fallback;
+    }
+
+    // A numeric field of the current book, or -1 if absent or not a number
+    long number(int field) const {
+        std::string_view digits = text(field, "");
+        if (digits.empty() || digits.size() > 18) return -1;
+
+        long value = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') return -1;
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+};
+
+/**
+ * Prints one book of a catalog the way book_printer prints it.
+ *
+ * @param catalog The book list.
+ * @param i       The position of the book.
+ */
+void printCatalogLine(const catalog &catalog, size_t i)
+{
+    std::string_view title = catalog_title(&catalog, i);
+    std::string_view author = catalog_author(&catalog, i);
+
+    std::cout << "- ID: ";
+    if (catalog.ids[i] < 0) {
+        std::cout << "N/A";
+    } else {
+        std::cout << catalog.ids[i];
+    }
+    std::cout << ", Title: " << (title.empty() ? "Unknown" : title)
+              << ", Author: " << (author.empty() ? "Unknown" : author) << '\n';
+}
+
+/**
+ * Prints a book list kept in a catalog, the way book_printer prints it
+ * from the server, so an unchanged list is shown without receiving it.
+ *
+ * @param catalog The book list.
+ */
+void printCatalog(const catalog &catalog)
+{
+    if (catalog.count == 0) {
+        std::cout << "No books available in the library." << std::endl;
+        return;
+    }
+
+    std::cout << "List of books:\n";
+    for (size_t i = 0; i < catalog.count; ++i) {
+        printCatalogLine(catalog, i);
+    }
+    std::cout << std::flush;
+}
+
+/**
+ * Prints the books of a catalog a query selects, in its order.
+ *
+ * @param catalog The book list.
+ * @param query   Filters, ordering and limit; an empty one prints every book.
+ */
+void printCatalogQuery(const catalog &catalog, const book_query &query)
+{
+    if (catalog.count == 0 || query_empty(&query)) {
+        printCatalog(catalog);
+        return;
+    }
+
+    std::vector<uint32_t> rows;
+    size_t matched = query_run(&query, &catalog, &rows);
+    if (matched == 0) {
+        std::cout << "No books match the query." << std::endl;
+        return;
+    }
+
+    // The header tells how many books matched when the limit left some out
+    std::cout << "List of books (";
+    if (rows.size() < matched) {
+        std::cout << rows.size() << " of ";
+    }
+    std::cout << matched << " matching):\n";
+
+    for (uint32_t i : rows) {
+        printCatalogLine(catalog, i);
+    }
+    std::cout << std::flush;
+}
+
+/**
+ * Reads the validators of a book list reply now, since its head is
+ * dropped once the body is read. Without a lifetime from the server, the
+ * list is revalidated every time.
+ *
+ * @param response The head of the reply.
+ * @return The validators to keep with the catalog.
+ */
+cache_validators listValidators(const http_response &response)
+{
+    cache_validators validators = extractValidators(response);
+    if (validators.max_age_ms < 0) {
+        validators.max_age_ms = 0;
+    }
+    return validators;
+}
+
+/**
+ * Retrieves a list of all books available in the library system, and
+ * prints it whole or the part a query selects (e.g. `get_books genre=SF
+ * page_count>300 sort=title limit=50`). The query runs over the catalog,
+ * so the server still sends the whole list.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has entered the library.
- * @param jwt    JWT token for authentication.
+ * @param cache  Holds the validators of the list in `catalog`, under BOOK_LIST_KEY.
+ * @param catalog Replaced with the received list, kept only if it parsed completely.
+ * @param memo   Size and hash of the body `catalog` was parsed from.
  * @param reply  Reference to a string where the server response will be stored.
+ * @param filter The query given with the command, empty to print every book.
  */
-void get_books(char *conn, int &sockfd, bool &login, bool &enter, std::string &jwt, std::string &reply)
+void get_books(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+               catalog &catalog, catalog_memo &memo, std::string &reply, const std::string &filter)
 {
     // Check if the user is logged in
     if (!login) {
@@ -27,53 +250,155 @@ void get_books(char *conn, int &sockfd, bool &login, bool &enter, std::string &j
         return;
     }
 
+    // Reject a bad query before anything is sent
+    book_query query;
+    std::string error;
+    if (!query_parse(filter, &query, &error)) {
+        std::cout << "ERROR: " << error << std::endl;
+        return;
+    }
+
+    // The catalog is the cached copy of the list: shown as is while fresh,
+    // shown at once and revalidated in the background while stale
+    std::string code;
+    cache_validators validators;
+    cache_state state = cache_get(&cache, BOOK_LIST_KEY, &code, NULL, &validators);
+
+    if (state == CACHE_FRESH || state == CACHE_STALE) {
+        if (state == CACHE_STALE) {
+            revalidateInBackground(session, cache, BOOK_LIST_KEY, BOOKS, validators);
+        }
+        reply = code;
+        printCatalogQuery(catalog, query);
+        return;
+    }
+
     // Construct and send the GET request to retrieve all books
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - BOOKS: The API endpoint for fetching all books.
-    // - NO_TOKEN: No additional authorization token needed.
-    // - jwt: Authentication token required for authorization.
-    // - {}: No additional headers.
-    // - 0: No extra parameters.
-    std::string message = GET(conn, BOOKS, NO_TOKEN, jwt, {}, 0);
-    sendServerMessage(sockfd, message);
-
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
-
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
-
-    // Parse the JSON response
-    nlohmann::json responseJSON;
-    try {
-        responseJSON = nlohmann::json::parse(jsonResponse);
-    } catch (const std::exception &e) {
-        std::cout << "ERROR: Failed to parse server response!" << std::endl;
-        return;
+    // - NO_QUERRY: No query parameters needed.
+    // - validators: Those of the catalog, so an unchanged list is answered with 304.
+    std::string message = state == CACHE_REVALIDATE
+                        ? GET(session, BOOKS, NO_QUERRY, validators.etag, validators.last_modified)
+                        : GET(session, BOOKS, NO_QUERRY);
+
+    // Send the request and receive only the status line and headers,
+    // the body is parsed below as it arrives
+    http_response response;
+    http_parser parser;
+    extractServerHead(response, parser, session, sockfd, message);
+    validators = listValidators(response);
+
+    // 304 Not Modified: the catalog is still current, unless its entry is
+    // gone meanwhile (dropped by a failed revalidation); then nothing
+    // vouches for the catalog any more, so the whole list is fetched again
+    if (response.status == 304) {
+        if (cache_refresh(&cache, BOOK_LIST_KEY, &validators)) {
+            reply = code;
+            printCatalogQuery(catalog, query);
+            return;
+        }
+
+        extractServerHead(response, parser, session, sockfd, GET(session, BOOKS, NO_QUERRY));
+        validators = listValidators(response);
     }
+    reply = response.code;
 
-    // Check if the JSON response contains an error
-    if (responseJSON.contains("error")) {
-        std::cout << "ERROR: " << reply << " <=> " << responseJSON["error"].get<std::string>() << std::endl;
+    // Error replies are small: read them whole and decode them once
+    if (response.status < 200 || response.status >= 300) {
+        std::string body = extractServerBody(sockfd, parser);
+        decoded_response decoded = decodeResponse(body);
+        if (decoded.kind == DECODE_EMPTY) {
+            std::cout << "ERROR: Unknown problem occurred!" << std::endl;
+            return;
+        }
+        errorJSONReply(decoded, reply);
         return;
     }
 
-    // Display the list of books in a readable format
-    if (responseJSON.is_array() && !responseJSON.empty()) {
-        std::cout << "List of books:\n";
-        for (const auto &book : responseJSON) {
-            std::cout << "- ID: " << book.value("id", "N/A") 
-                      << ", Title: " << book.value("title", "Unknown") 
-                      << ", Author: " << book.value("author", "Unknown") << std::endl;
+    // The body is often byte-identical to the one the catalog was parsed
+    // from. When it announces exactly that size, it is held while hashed,
+    // and if the hash matches too the catalog is printed instead of parsing
+    // the body again. A body of any other or unknown size is never held: it
+    // is hashed as it streams into the parser, and a match is only found at
+    // its end, in time to keep the catalog rather than the copy just parsed
+    std::string held;
+    hash64_state hash;
+    hash64_init(&hash, 0);
+
+    if (memo.size > 0 && parser.content_length >= 0 && (size_t)parser.content_length == memo.size) {
+        held.reserve(memo.size);
+        for (std::string_view piece = recvServerBody(sockfd, &parser); !piece.empty();
+             piece = recvServerBody(sockfd, &parser)) {
+            held.append(piece);
+            hash64_update(&hash, piece.data(), piece.size());
         }
+
+        if (held.size() == memo.size && hash64_digest(&hash) == memo.hash) {
+            ++memo.hits;
+            printCatalogQuery(catalog, query);
+            cache_put(&cache, BOOK_LIST_KEY, reply, "", &validators);
+            return;
+        }
+    }
+
+    // Stream the body (after the bytes held above) from the socket into the SAX handler
+    body_streambuf body(sockfd, parser, held, &hash);
+    std::istream stream(&body);
+    // If no JSON response is present, indicate an unknown issue
+    if (stream.peek() == std::char_traits<char>::eof()) {
+        std::cout << "ERROR: Unknown problem occurred!" << std::endl;
+        return;
+    }
+
+    ::catalog list = catalog_init();
+    bool echo = query_empty(&query);
+    book_printer printer(&list, echo);
+    nlohmann::json::sax_parse(stream, &printer);
+
+    // Skip whatever the JSON parser left unread, so the connection can be reused
+    for (std::string_view piece = recvServerBody(sockfd, &parser); !piece.empty();
+         piece = recvServerBody(sockfd, &parser)) {
+        hash64_update(&hash, piece.data(), piece.size());
+    }
+    std::cout << std::flush;
+
+    bool same = memo.size > 0 && hash.total == memo.size && hash64_digest(&hash) == memo.hash;
+    if (same) {
+        ++memo.hits;
     } else {
-        std::cout << "No books available in the library." << std::endl;
+        ++memo.misses;
     }
 
-    // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
+    if (printer.failed) {
+        std::cout << "ERROR: Failed to parse server response!" << std::endl;
+    } else if (!printer.error.empty()) {
+        std::cout << "ERROR: " << reply << " <=> " << printer.error << std::endl;
+    } else {
+        if (printer.books == 0 && echo) {
+            std::cout << "No books available in the library." << std::endl;
+        }
+
+        // Keep the list for later lookups, and its validators for the next get_books;
+        // a body identical to the last one leaves the catalog, its index and snapshot as they are
+        if (printer.is_list && same) {
+            cache_put(&cache, BOOK_LIST_KEY, reply, "", &validators);
+        } else if (printer.is_list) {
+            std::swap(catalog, list);
+            cache_put(&cache, BOOK_LIST_KEY, reply, "", &validators);
+            memo.size = hash.total;
+            memo.hash = hash64_digest(&hash);
+
+            // Save it for the next run; failing to is not an error, it only costs a cold start
+            catalog_index(&catalog);
+            snapshot_save(snapshotPath(session).c_str(), &catalog, &memo, &validators);
+        }
+
+        // Books were only kept while parsing, select and print them now
+        if (!echo) {
+            printCatalogQuery(printer.is_list ? catalog : list, query);
+        }
+    }
 }
 
 #endif /* GET_BOOKS */
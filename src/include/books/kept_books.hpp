@@ -0,0 +1,86 @@
+#ifndef KEPT_BOOKS
+#define KEPT_BOOKS
+
+#include <stdio.h>
+
+#include "../response.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/hash.hpp"
+#include "../../utils/snapshot.hpp"
+#include "../../utils/trigram.hpp"
+
+/**
+ * Names the file the book list of the logged-in user is saved to. There
+ * is one per server and user, so a list is only ever loaded back for the
+ * user who fetched it.
+ *
+ * @param session Session of the user.
+ * @return The file name.
+ */
+std::string snapshotPath(const session &session)
+{
+    uint64_t key = hash64(session.user.data(), session.user.size(),
+                          hash64(session.host.data(), session.host.size(), 0));
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return SNAPSHOT_PREFIX + std::string(name) + SNAPSHOT_SUFFIX;
+}
+
+/**
+ * Loads the book list the user saved in a previous run, once the server
+ * has let them into the library. Its validators make the first get_books
+ * a conditional request; until then it is not fresh, so get_book does
+ * not answer from it.
+ *
+ * @param session Session of the user.
+ * @param cache   Given the validators of the list, under BOOK_LIST_KEY.
+ * @param catalog Replaced with the saved list, if there is one.
+ * @param memo    Replaced with the size and hash of the body it came from.
+ */
+void restoreCatalog(const session &session, reply_cache &cache, catalog &catalog, catalog_memo &memo)
+{
+    cache_validators validators = cache_validators_init();
+    if (snapshot_load(snapshotPath(session).c_str(), &catalog, &memo, &validators)) {
+        validators.max_age_ms = 0;
+        cache_put(&cache, BOOK_LIST_KEY, "200", "", &validators);
+    }
+}
+
+/**
+ * Forgets the book list kept in memory, once it may belong to someone
+ * else (at logout). The counters of the memo are kept for `stats`.
+ *
+ * @param catalog The book list, emptied.
+ * @param memo    Reset, so no body matches it.
+ * @param index   The trigram index over the list, released.
+ */
+void forgetCatalog(catalog &catalog, catalog_memo &memo, trigram_index &index)
+{
+    catalog_clear(&catalog);
+    memo.size = 0;
+    memo.hash = 0;
+    index = trigram_init();
+}
+
+/**
+ * Drops the book list once the user changed the library (add_book or
+ * delete_book), whatever the outcome: neither the list in memory nor the
+ * one saved for the next run can be trusted until get_books fetches it
+ * again.
+ *
+ * @param session Session of the user.
+ * @param cache   The validators of the list are dropped from it.
+ * @param catalog The book list, emptied.
+ * @param memo    Reset, so no body matches it.
+ * @param index   The trigram index over the list, released.
+ */
+void discardCatalog(const session &session, reply_cache &cache, catalog &catalog, catalog_memo &memo,
+                    trigram_index &index)
+{
+    cache_invalidate(&cache, BOOK_LIST_KEY);
+    forgetCatalog(catalog, memo, index);
+    remove(snapshotPath(session).c_str());
+}
+
+#endif /* KEPT_BOOKS */
@@ -0,0 +1,57 @@
+#ifndef SEARCH_BOOKS
+#define SEARCH_BOOKS
+
+#include "../response.hpp"
+#include "../../utils/catalog.hpp"
+#include "../../utils/trigram.hpp"
+
+/**
+ * Finds the books whose title, author or publisher contains a text, in
+ * the catalog kept from the last get_books (or loaded from the snapshot).
+ * Nothing is sent to the server; the trigram index is brought up to date
+ * with the catalog first.
+ *
+ * @param catalog The book list searched.
+ * @param memo    Identifies the catalog's content, for the index.
+ * @param index   Trigram index over the catalog.
+ * @param text    The text looked for (ignoring case), prompted for if empty.
+ */
+void search_books(const catalog &catalog, const catalog_memo &memo, trigram_index &index, std::string text)
+{
+    // Prompt the user for the text if it was not given with the command
+    if (text.empty()) {
+        std::cout << "Enter the search text: ";
+        std::getline(std::cin >> std::ws, text);
+    }
+
+    if (catalog.count == 0) {
+        std::cout << "ERROR: No books kept yet, run get_books first!" << std::endl;
+        return;
+    }
+
+    trigram_update(&index, &catalog, memo.hash ^ memo.size);
+
+    std::vector<uint32_t> matches;
+    trigram_search(&index, &catalog, text, &matches);
+
+    if (matches.empty()) {
+        std::cout << "No books match \"" << text << "\"." << std::endl;
+        return;
+    }
+
+    std::cout << "Found " << matches.size() << (matches.size() == 1 ? " book:\n" : " books:\n");
+    for (uint32_t i : matches) {
+        std::cout << "- ID: ";
+        if (catalog.ids[i] < 0) {
+            std::cout << "N/A";
+        } else {
+            std::cout << catalog.ids[i];
+        }
+        std::cout << ", Title: " << catalog_title(&catalog, i)
+                  << ", Author: " << catalog_author(&catalog, i)
+                  << ", Publisher: " << catalog_publisher(&catalog, i) << '\n';
+    }
+    std::cout << std::flush;
+}
+
+#endif /* SEARCH_BOOKS */
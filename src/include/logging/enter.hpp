@@ -2,20 +2,22 @@
 #define ENTER_HPP
 
 #include "../response.hpp"
+#include "../books/kept_books.hpp"
 
 /**
  * Attempts to enter the library if the user is logged in.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has already entered the library.
- * @param jwt    Reference to a string where the JWT token will be stored upon successful entry.
+ * @param cache  Given the validators of the book list saved by the user, if any.
+ * @param catalog Replaced with the book list saved by the user in a previous run, if any.
+ * @param memo   Replaced with the size and hash of the body that list came from.
  * @param reply  Reference to a string where the server response code will be stored.
- * @param cookie Session cookie required for authentication.
  */
-void enter_library(char *conn, int &sockfd, bool &login, bool &enter, 
-                   std::string &jwt, std::string &reply, std::string &cookie)
+void enter_library(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+                   catalog &catalog, catalog_memo &memo, std::string &reply)
 {
     // Check if the user is logged in
     if (!login) {
@@ -29,58 +31,46 @@ void enter_library(char *conn, int &sockfd, bool &login, bool &enter,
         return;
     }
 
-    // Mark the user as inside the library
-    enter = true;
-
     // Construct and send the GET request to access the library
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - ACCESS: The API endpoint for entering the library.
     // - NO_QUERY: No additional query parameters needed.
-    // - NO_TOKEN: No additional authorization token required.
-    // - {cookie}: The session cookie required for authentication.
-    // - 1: Number of additional headers (cookie in this case).
-    std::string message = GET(conn, ACCESS, NO_QUERRY, NO_TOKEN, {cookie}, 1);
-    sendServerMessage(sockfd, message);
+    std::string message = GET(session, ACCESS, NO_QUERRY);
 
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
 
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // Check if the response is empty (unexpected error)
-    if (jsonResponse.empty()) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << "ERROR: Unknown problem occurred!" << std::endl;
         return;
     }
 
-    // Parse the JSON response
-    nlohmann::json responseJSON;
-    try {
-        responseJSON = nlohmann::json::parse(jsonResponse);
-    } catch (const std::exception &e) {
-        std::cout << "ERROR: Failed to parse server response!" << std::endl;
-        return;
-    }
-
-    // Check if the JSON response contains an error
-    if (responseJSON.contains("error")) {
-        std::cout << "ERROR: " << reply << " <=> " << responseJSON["error"].get<std::string>() << std::endl;
+    // Handle the JSON error response from the server
+    if (decoded.kind != DECODE_SUCCESS) {
+        errorJSONReply(decoded, reply);
         return;
     }
 
     // Successfully entered the library, retrieve JWT token
-    if (responseJSON.contains("token")) {
-        jwt = responseJSON["token"].get<std::string>();
+    std::string token;
+    if (json_get_string(json_find(decoded.json, "token"), &token)) {
+        session_set_token(&session, token);
+
+        // Mark the user as inside the library
+        enter = true;
         std::cout << "SUCCESS: " << reply << " - Entered the library successfully." << std::endl;
+
+        // Only now is the user known to the server: start from their saved book list
+        restoreCatalog(session, cache, catalog, memo);
     } else {
         std::cout << "ERROR: Server response did not include a valid token!" << std::endl;
     }
-
-    // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
 }
 
 #endif /* ENTER_HPP */
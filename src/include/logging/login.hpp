@@ -6,13 +6,12 @@
 /**
  * Handles user login by sending credentials to the server.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param loginB Boolean flag indicating if the user is already logged in.
  * @param reply  Reference to a string where the server response code will be stored.
- * @param cookie Reference to a string where the session cookie will be stored upon successful login.
  */
-void login(char *conn, int &sockfd, bool &loginB, std::string &reply, std::string &cookie)
+void login(session &session, int &sockfd, bool &loginB, std::string &reply)
 {
     // Check if the user is already logged in
     if (loginB) {
@@ -22,7 +21,7 @@ void login(char *conn, int &sockfd, bool &loginB, std::string &reply, std::strin
 
     std::string username;
     std::string password;
-    nlohmann::json json;
+    arena_json json;
 
     // Get username from the user
     std::cout << "Enter username: ";
@@ -35,59 +34,46 @@ void login(char *conn, int &sockfd, bool &loginB, std::string &reply, std::strin
     json["password"] = password;
 
     // Convert JSON object to a string payload
-    std::string jsonPayload = json.dump();
-    size_t payloadLength = jsonPayload.length();
+    arena_string jsonPayload = json.dump();
 
     // Construct and send the POST request for login
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - LOGIN: The API endpoint for user login.
-    // - NO_TOKEN: No additional authorization token needed.
     // - APP: The content type (usually "application/json").
     // - jsonPayload: The serialized JSON payload containing login credentials.
-    // - payloadLength: The length of the JSON string.
-    // - {}: No additional headers.
-    // - 0: No extra parameters.
-    std::string message = POST(conn, LOGIN, NO_TOKEN, APP, jsonPayload, payloadLength, {}, 0);
-    sendServerMessage(sockfd, message);
+    std::string message = POST(session, LOGIN, APP, jsonPayload);
 
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
 
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // Check if the response is empty (unexpected error)
-    if (jsonResponse.empty()) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << "ERROR: Unknown problem occurred during login!" << std::endl;
         return;
     }
 
-    // Parse the JSON response
-    nlohmann::json responseJSON;
-    try {
-        responseJSON = nlohmann::json::parse(jsonResponse);
-    } catch (const std::exception &e) {
-        std::cout << "ERROR: Failed to parse server response!" << std::endl;
+    // Handle the JSON error response from the server
+    if (decoded.kind != DECODE_SUCCESS) {
+        errorJSONReply(decoded, reply);
         return;
     }
 
     // Extract session cookie if login is successful
-    std::string sidIndicator = "connect.sid=";
-    size_t sidPos = response.find(sidIndicator);
-    if (sidPos != std::string::npos) {
-        std::string cookieStr = response.substr(sidPos);
-        cookie = cookieStr.substr(0, cookieStr.find(";")); // Extract session cookie
+    std::string_view sid = extractSetCookie(response, "connect.sid=");
+    if (!sid.empty()) {
+        session_set_cookie(&session, sid); // Store session cookie
     } else {
         std::cout << "ERROR: Session cookie not found in response!" << std::endl;
         return;
     }
 
-    // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
-
     // Successfully logged in
+    session.user = username;
     loginB = true;
     std::cout << "SUCCESS: " << reply << " - Logged in successfully." << std::endl;
 }
@@ -2,20 +2,23 @@
 #define LOGOUT_HPP
 
 #include "../response.hpp"
+#include "../books/kept_books.hpp"
 
 /**
  * Logs the user out of the library system.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is logged in.
  * @param enter  Boolean flag indicating if the user has entered the library.
- * @param jwt    Reference to a string where the JWT token will be cleared upon logout.
+ * @param cache  Replies of recent lookups, dropped with the session.
+ * @param catalog The last book list, dropped with the session (its snapshot stays for the user's next visit).
+ * @param memo   Size and hash of the body `catalog` was parsed from.
+ * @param index  Trigram index over `catalog`.
  * @param reply  Reference to a string where the server response code will be stored.
- * @param cookie Reference to a string where the session cookie will be cleared upon logout.
  */
-void logout(char *conn, int &sockfd, bool &login, bool &enter, 
-            std::string &jwt, std::string &reply, std::string &cookie)
+void logout(session &session, int &sockfd, bool &login, bool &enter, reply_cache &cache,
+            catalog &catalog, catalog_memo &memo, trigram_index &index, std::string &reply)
 {
     // Check if the user is logged in
     if (!login) {
@@ -24,37 +27,35 @@ void logout(char *conn, int &sockfd, bool &login, bool &enter,
     }
 
     // Construct and send the GET request for logout
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - LOGOUT: The API endpoint for logging out.
     // - NO_QUERY: No additional query parameters needed.
-    // - NO_TOKEN: No additional authorization token required.
-    // - {cookie}: The session cookie required for authentication.
-    // - cookie.empty() ? 0 : 1: Determines if a cookie should be sent (avoids unnecessary headers).
-    std::string message = GET(conn, LOGOUT, NO_QUERRY, NO_TOKEN, {cookie}, cookie.empty() ? 0 : 1);
-    sendServerMessage(sockfd, message);
+    std::string message = GET(session, LOGOUT, NO_QUERRY);
 
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
 
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // Check if the response is empty (logout successful)
-    if (jsonResponse.empty()) {
+    if (decoded.kind == DECODE_EMPTY) {
         // Reset login-related flags and clear session credentials
         login = false;
         enter = false;
-        cookie.clear();
-        jwt.clear();
+        session_clear(&session);
+        revalidateWait();
+        cache_clear(&cache);
+        forgetCatalog(catalog, memo, index);
 
         std::cout << "SUCCESS: " << reply << " - Logged out successfully." << std::endl;
         return;
     }
 
     // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
+    errorJSONReply(decoded, reply);
 }
 
 #endif /* LOGOUT_HPP */
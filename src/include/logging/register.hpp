@@ -6,12 +6,12 @@
 /**
  * Handles user registration by sending credentials to the server.
  *
- * @param conn   Connection string for the server.
+ * @param session Session holding the server host and credentials.
  * @param sockfd Socket file descriptor for communication.
  * @param login  Boolean flag indicating if the user is already logged in.
  * @param reply  Reference to a string where the server response code will be stored.
  */
-void register_credentials(char *conn, int &sockfd, bool &login, std::string &reply)
+void register_credentials(session &session, int &sockfd, bool &login, std::string &reply)
 {
     // Check if the user is already logged in
     if (login) {
@@ -19,7 +19,7 @@ void register_credentials(char *conn, int &sockfd, bool &login, std::string &rep
         return;
     }
 
-    nlohmann::json json;
+    arena_json json;
 
     // Get username from the user
     std::string username;
@@ -34,37 +34,31 @@ void register_credentials(char *conn, int &sockfd, bool &login, std::string &rep
     json["password"] = password;
 
     // Convert JSON object to a string payload
-    std::string jsonPayload = json.dump();
-    size_t payloadLength = jsonPayload.length();
+    arena_string jsonPayload = json.dump();
 
     // Construct and send the POST request for registration
-    // - conn: The server connection details.
+    // - session: The server host and credentials, as pre-serialized headers.
     // - REGISTER: The API endpoint for user registration.
-    // - NO_TOKEN: No additional authorization token needed.
     // - APP: The content type (usually "application/json").
     // - jsonPayload: The serialized JSON payload containing login credentials.
-    // - payloadLength: The length of the JSON string.
-    // - {}: No additional headers.
-    // - 0: No extra parameters.
-    std::string message = POST(conn, REGISTER, NO_TOKEN, APP, jsonPayload, payloadLength, {}, 0);
-    sendServerMessage(sockfd, message);
+    std::string message = POST(session, REGISTER, APP, jsonPayload);
 
-    // Receive the server's response
-    std::string response;
-    extractServerResponse(response, sockfd);
+    // Send the request and receive the server's response
+    http_response response;
+    extractServerResponse(response, session, sockfd, message);
 
-    // Extract response code and JSON content (if any)
-    reply = extractJSONCode(response);
-    std::string jsonResponse = extractJSONResponse(response);
+    // Extract response code and decode the JSON content (if any)
+    reply = response.code;
+    decoded_response decoded = decodeResponse(response);
 
     // Check if the response is empty (registration successful)
-    if (jsonResponse.empty()) {
+    if (decoded.kind == DECODE_EMPTY) {
         std::cout << "SUCCESS: " << reply << " - User registered successfully." << std::endl;
         return;
     }
 
     // Handle the JSON error response from the server
-    errorJSONReply(jsonResponse, reply);
+    errorJSONReply(decoded, reply);
 }
 
 #endif /* REGISTER_HPP */
@@ -1,194 +1,236 @@
 #include <string>
-#include <cstring>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netdb.h>
-#include <arpa/inet.h>
-
-#include "../utils/helpers.hpp"
+#include <cstdio>
 
 #include "requests.hpp"
 
+#define CRLF "\r\n"
+#define LITERAL_SIZE(literal) (sizeof(literal) - 1)
+
+// Parts of a request message, serialized by buildRequest()
+typedef struct {
+    std::string_view method;
+    std::string_view url;
+    std::string_view query_params;
+    std::string_view headers;      // pre-serialized session headers
+    std::string_view content_type;
+    std::string_view body;
+    bool has_body;
+    std::string_view if_none_match;     // conditional GET validators, empty if unused
+    std::string_view if_modified_since;
+} request_parts;
+
 /**
- * Constructs a GET request message.
+ * Serializes the Host, Authorization and Cookie lines of a session.
+ * Called only when one of them changes, never per request.
  *
- * @param host          Server host address.
- * @param url           Target URL.
- * @param query_params  Query parameters (optional).
- * @param token         Authorization token (optional).
- * @param cookies       List of cookies (optional).
- * @param cookies_count Number of cookies.
- * @return Pointer to the constructed GET request message.
+ * @param session The session to update.
  */
-char* GET(std::string host, std::string url, 
-          std::string query_params, std::string token,
-          std::vector<std::string> cookies, int cookies_count)
+static void buildSessionHeaders(session *session)
 {
-    char line[LINELEN];
-    char* message = new char[2 * BUFFLEN];
-    char* cookiesString = new char[BUFFLEN];
+    size_t size = LITERAL_SIZE("Host: " CRLF) + session->host.size();
+    if (!session->token.empty())
+        size += LITERAL_SIZE("Authorization: Bearer " CRLF) + session->token.size();
+    if (!session->cookie.empty())
+        size += LITERAL_SIZE("Cookie: ;" CRLF) + session->cookie.size();
 
-    // Construct the GET request line
-    if (!query_params.empty())
-        snprintf(line, sizeof(line), "GET %s?%s HTTP/1.1", url.c_str(), query_params.c_str());
-    else
-        snprintf(line, sizeof(line), "GET %s HTTP/1.1", url.c_str());
+    std::string &headers = session->headers;
+    headers.clear();
+    headers.reserve(size);
 
-    httpMessage(message, line);
+    // Add host header
+    headers.append("Host: ").append(session->host).append(CRLF);
 
     // Add authorization token if provided
-    if (!token.empty()) {
-        strcat(message, "Authorization: Bearer ");
-        httpMessage(message, token.c_str());
+    if (!session->token.empty()) {
+        headers.append("Authorization: Bearer ").append(session->token).append(CRLF);
     }
 
-    // Add host header
-    strcat(message, "Host: ");
-    httpMessage(message, host.c_str());
-
-    // Add cookies if provided
-    if (!cookies.empty()) {
-        strcpy(cookiesString, "Cookie:");
-        for (const auto& cookie : cookies) {
-            strcat(cookiesString, " ");
-            strcat(cookiesString, cookie.c_str());
-            strcat(cookiesString, ";");
-        }
-        httpMessage(message, cookiesString);
+    // Add the session cookie if provided
+    if (!session->cookie.empty()) {
+        headers.append("Cookie: ").append(session->cookie).append(";" CRLF);
     }
+}
 
-    // Add a blank line to separate headers from body
-    httpMessage(message, "");
+/**
+ * Creates a session with no credentials.
+ *
+ * @param host Server host address.
+ * @return The session.
+ */
+session session_init(std::string_view host)
+{
+    session session;
+    session.host = host;
+    buildSessionHeaders(&session);
+    return session;
+}
 
-    delete[] cookiesString;
-    return message;
+/**
+ * Stores the JWT token and re-serializes the session headers.
+ *
+ * @param session The session to update.
+ * @param token   Authorization token (empty to drop it).
+ */
+void session_set_token(session *session, std::string_view token)
+{
+    if (session->token == token) return;
+    session->token = token;
+    buildSessionHeaders(session);
 }
 
 /**
- * Constructs a POST request message.
+ * Stores the session cookie and re-serializes the session headers.
  *
- * @param host          Server host address.
- * @param url           Target URL.
- * @param token         Authorization token (optional).
- * @param content_type  Content type of the request body.
- * @param body          Request body (JSON payload).
- * @param body_fields_nr Number of fields in the request body.
- * @param cookies       List of cookies (optional).
- * @param cookies_count Number of cookies.
- * @return Pointer to the constructed POST request message.
+ * @param session The session to update.
+ * @param cookie  Session cookie (empty to drop it).
  */
-char* POST(std::string host, std::string url, 
-           std::string token, std::string content_type,
-           std::string body, int body_fields_nr, 
-           std::vector<std::string> cookies, int cookies_count)
+void session_set_cookie(session *session, std::string_view cookie)
 {
-    char* message = new char[2 * BUFFLEN];
-    char* cookiesString = new char[BUFFLEN];
+    if (session->cookie == cookie) return;
+    session->cookie = cookie;
+    buildSessionHeaders(session);
+}
 
-    // Construct the POST request line
-    snprintf(message, 2 * BUFFLEN, "POST %s HTTP/1.1\r\n", url.c_str());
+/**
+ * Drops the token and cookie of a session.
+ *
+ * @param session The session to reset.
+ */
+void session_clear(session *session)
+{
+    session->token.clear();
+    session->cookie.clear();
+    session->user.clear();
+    buildSessionHeaders(session);
+}
 
-    // Add host header
-    strcat(message, "Host: ");
-    httpMessage(message, host.c_str());
+/**
+ * Serializes a request message. The exact size is computed first, so the
+ * message is written with a single allocation: the request line, a copy
+ * of the session header block, and the body headers and body if any.
+ *
+ * @param parts The request line, headers and body.
+ * @return The request message.
+ */
+static std::string buildRequest(const request_parts &parts)
+{
+    char content_length[24];
+    size_t content_length_size = 0;
+    if (parts.has_body) {
+        content_length_size = snprintf(content_length, sizeof(content_length), "%zu", parts.body.size());
+    }
 
-    // Add authorization token if provided
-    if (!token.empty()) {
-        strcat(message, "Authorization: Bearer ");
-        httpMessage(message, token.c_str());
+    // Request line, session headers and the blank line
+    size_t size = parts.method.size() + 1 + parts.url.size() + LITERAL_SIZE(" HTTP/1.1" CRLF)
+                + parts.headers.size() + LITERAL_SIZE(CRLF);
+    if (!parts.query_params.empty())
+        size += 1 + parts.query_params.size();
+    if (parts.has_body && !parts.content_type.empty())
+        size += LITERAL_SIZE("Content-Type: " CRLF) + parts.content_type.size();
+    if (parts.has_body)
+        size += LITERAL_SIZE("Content-Length: " CRLF) + content_length_size + parts.body.size();
+    if (!parts.if_none_match.empty())
+        size += LITERAL_SIZE("If-None-Match: " CRLF) + parts.if_none_match.size();
+    if (!parts.if_modified_since.empty())
+        size += LITERAL_SIZE("If-Modified-Since: " CRLF) + parts.if_modified_since.size();
+
+    std::string message;
+    message.reserve(size);
+
+    // Construct the request line
+    message.append(parts.method).append(" ").append(parts.url);
+    if (!parts.query_params.empty()) {
+        message.append("?").append(parts.query_params);
+    }
+    message.append(" HTTP/1.1" CRLF);
+
+    // Add the Host, Authorization and Cookie lines in one copy
+    message.append(parts.headers);
+
+    // Add the validators of a cached copy, if any
+    if (!parts.if_none_match.empty()) {
+        message.append("If-None-Match: ").append(parts.if_none_match).append(CRLF);
+    }
+    if (!parts.if_modified_since.empty()) {
+        message.append("If-Modified-Since: ").append(parts.if_modified_since).append(CRLF);
     }
 
-    // Add content type header
-    strcat(message, "Content-Type: ");
-    httpMessage(message, content_type.c_str());
-
-    // Add content length header
-    char content_length[32];
-    snprintf(content_length, sizeof(content_length), "Content-Length: %d\r\n", body_fields_nr);
-    strcat(message, content_length);
-
-    // Add cookies if provided
-    if (!cookies.empty()) {
-        strcpy(cookiesString, "Cookie:");
-        for (const auto& cookie : cookies) {
-            strcat(cookiesString, " ");
-            strcat(cookiesString, cookie.c_str());
-            strcat(cookiesString, ";");
+    // Add content type and length headers
+    if (parts.has_body) {
+        if (!parts.content_type.empty()) {
+            message.append("Content-Type: ").append(parts.content_type).append(CRLF);
         }
-        httpMessage(message, cookiesString);
+        message.append("Content-Length: ").append(content_length, content_length_size).append(CRLF);
     }
 
     // Add a blank line to separate headers from body
-    httpMessage(message, "");
+    message.append(CRLF);
 
-    // Add the request body
-    httpMessage(message, body.c_str());
+    // Add the request body (no trailing CRLF: on a keep-alive connection
+    // any byte past Content-Length would be read as the next request)
+    if (parts.has_body) {
+        message.append(parts.body);
+    }
 
-    delete[] cookiesString;
     return message;
 }
 
 /**
- * Constructs a DELETE request message.
+ * Constructs a GET request message.
  *
- * @param host          Server host address.
+ * @param session       Session whose headers are sent.
  * @param url           Target URL.
- * @param token         Authorization token (optional).
- * @param content_type  Content type of the request body.
- * @param body          Request body (JSON payload, optional).
- * @param body_fields_nr Number of fields in the request body.
- * @param cookies       List of cookies (optional).
- * @param cookies_count Number of cookies.
- * @return Pointer to the constructed DELETE request message.
+ * @param query_params  Query parameters (optional).
+ * @return The constructed GET request message.
  */
-char* DELETE(std::string host, std::string url, 
-             std::string token, std::string content_type,
-             std::string body, int body_fields_nr,
-             std::vector<std::string> cookies, int cookies_count)
+std::string GET(const session &session, std::string_view url, std::string_view query_params)
 {
-    char* message = new char[2 * BUFFLEN];
-    char* cookiesString = new char[BUFFLEN];
-
-    // Construct the DELETE request line
-    snprintf(message, 2 * BUFFLEN, "DELETE %s HTTP/1.1\r\n", url.c_str());
-
-    // Add host header
-    strcat(message, "Host: ");
-    httpMessage(message, host.c_str());
-
-    // Add authorization token if provided
-    if (!token.empty()) {
-        strcat(message, "Authorization: Bearer ");
-        httpMessage(message, token.c_str());
-    }
-
-    // Add content type header
-    strcat(message, "Content-Type: ");
-    httpMessage(message, content_type.c_str());
-
-    // Add content length header
-    char content_length[32];
-    snprintf(content_length, sizeof(content_length), "Content-Length: %d\r\n", body_fields_nr);
-    strcat(message, content_length);
-
-    // Add cookies if provided
-    if (!cookies.empty()) {
-        strcpy(cookiesString, "Cookie:");
-        for (const auto& cookie : cookies) {
-            strcat(cookiesString, " ");
-            strcat(cookiesString, cookie.c_str());
-            strcat(cookiesString, ";");
-        }
-        httpMessage(message, cookiesString);
-    }
+    return buildRequest({"GET", url, query_params, session.headers, "", "", false, "", ""});
+}
 
-    // Add a blank line to separate headers from body
-    httpMessage(message, "");
+/**
+ * Constructs a conditional GET request message, answered with
+ * 304 Not Modified if the copy described by the validators is current.
+ *
+ * @param session       Session whose headers are sent.
+ * @param url           Target URL.
+ * @param query_params  Query parameters (optional).
+ * @param etag          ETag of the cached copy (optional).
+ * @param last_modified Last-Modified of the cached copy (optional).
+ * @return The constructed GET request message.
+ */
+std::string GET(const session &session, std::string_view url, std::string_view query_params,
+                std::string_view etag, std::string_view last_modified)
+{
+    return buildRequest({"GET", url, query_params, session.headers, "", "", false, etag, last_modified});
+}
 
-    // Add the request body
-    httpMessage(message, body.c_str());
+/**
+ * Constructs a POST request message.
+ *
+ * @param session       Session whose headers are sent.
+ * @param url           Target URL.
+ * @param content_type  Content type of the request body.
+ * @param body          Request body (JSON payload).
+ * @return The constructed POST request message.
+ */
+std::string POST(const session &session, std::string_view url,
+                 std::string_view content_type, std::string_view body)
+{
+    return buildRequest({"POST", url, "", session.headers, content_type, body, true, "", ""});
+}
 
-    delete[] cookiesString;
-    return message;
+/**
+ * Constructs a DELETE request message.
+ *
+ * @param session       Session whose headers are sent.
+ * @param url           Target URL.
+ * @param content_type  Content type of the request body (optional).
+ * @param body          Request body (JSON payload, optional).
+ * @return The constructed DELETE request message.
+ */
+std::string DELETE(const session &session, std::string_view url,
+                   std::string_view content_type, std::string_view body)
+{
+    return buildRequest({"DELETE", url, "", session.headers, content_type, body, true, "", ""});
 }
@@ -2,57 +2,77 @@
 #define REQUESTS_HPP
 
 #include <string>
-#include <vector>
+#include <string_view>
+
+// Session credentials, with the headers they produce kept pre-serialized
+typedef struct {
+    std::string host;    // server host, sent as the Host header
+    std::string token;   // JWT token received from the library access
+    std::string cookie;  // session cookie received at login
+    std::string user;    // username logged in with, the books kept on disk are theirs
+    std::string headers; // Host, Authorization and Cookie lines, CRLF terminated
+} session;
 
 /**
  * @param host host server
+ * @return a session with no credentials
+ */
+session session_init(std::string_view host);
+
+/**
+ * @param session session to update
+ * @param token authentication token (empty to drop it)
+ */
+void session_set_token(session *session, std::string_view token);
+
+/**
+ * @param session session to update
+ * @param cookie session cookie (empty to drop it)
+ */
+void session_set_cookie(session *session, std::string_view cookie);
+
+/**
+ * @param session session to reset, only the host is kept
+ */
+void session_clear(session *session);
+
+/**
+ * @param session session whose headers are sent
  * @param url URL path of the request
  * @param query_params query parameters of the request
- * @param token authentication token for the request
- * @param cookies cookies to include in the request
- * @param cookies_count number of cookies
- * @return computed GET request message as a char array
+ * @return computed GET request message
  */
-char *GET(
-    std::string host, std::string url, 
-    std::string query_params, std::string token, 
-    std::vector<std::string> cookies, int cookies_count
-);
+std::string GET(const session &session, std::string_view url, std::string_view query_params);
 
 /**
- * @param host host server
+ * @param session session whose headers are sent
+ * @param url URL path of the request
+ * @param query_params query parameters of the request
+ * @param etag validator sent as If-None-Match (empty to omit it)
+ * @param last_modified validator sent as If-Modified-Since (empty to omit it)
+ * @return computed conditional GET request message
+ */
+std::string GET(const session &session, std::string_view url, std::string_view query_params,
+                std::string_view etag, std::string_view last_modified);
+
+/**
+ * @param session session whose headers are sent
  * @param url URL path of the request
- * @param token authentication token for the request
  * @param content_type content type of the request
  * @param body body data of the request
- * @param body_fields_nr number of fields in the body data
- * @param cookies cookies to include in the request
- * @param cookies_count number of cookies
- * @return computed POST request message as a char array
+ * @return computed POST request message
  */
-char *POST(
-    std::string host, std::string url,
-    std::string token, std::string content_type, 
-    std::string body, int body_fields_nr, 
-    std::vector<std::string> cookies, int cookies_count
-);
+std::string POST(const session &session, std::string_view url,
+                 std::string_view content_type, std::string_view body);
 
 /**
- * @param host host server
+ * @param session session whose headers are sent
  * @param url URL path of the request
- * @param token authentication token for the request
  * @param content_type content type of the request
  * @param body body data of the request
- * @param body_fields_nr number of fields in the body data
- * @param cookies cookies to include in the request
- * @param cookies_count number of cookies
- * @return computed DELETE request message as a char array
- */
-char *DELETE(
-    std::string host, std::string url, 
-    std::string token, std::string content_type, 
-    std::string body, int body_fields_nr, 
-    std::vector<std::string> cookies, int cookies_count
-);
+ * @return computed DELETE request message
+ */
+std::string DELETE(const session &session, std::string_view url,
+                   std::string_view content_type, std::string_view body);
 
 #endif /* REQUESTS_HPP */
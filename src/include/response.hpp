@@ -2,9 +2,17 @@
 #define RESPONSE_HPP
 
 #include <iostream>
+#include <streambuf>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <vector>
 #include <algorithm>
 #include <cctype>
+#include <strings.h>
 #include <unistd.h>
 #include <netdb.h>
 #include <sys/socket.h>
@@ -12,7 +20,11 @@
 #include <arpa/inet.h>
 
 #include "../lib/json.hpp"
+#include "arena.hpp"
 #include "../utils/helpers.hpp"
+#include "../utils/ondemand.hpp"
+#include "../utils/cache.hpp"
+#include "../utils/hash.hpp"
 #include "requests.hpp"
 
 // User input prompts
@@ -29,6 +41,20 @@
 #define PORT_HTTP 8080
 #define IP_SERVER "34.254.242.81"
 
+// Replies of get_book kept for repeated lookups
+#define BOOK_CACHE_CAPACITY 1024
+#define BOOK_CACHE_TTL_MS 60000
+
+// Cache key of the book list; its body is the catalog, only validators are
+// cached. Negative, so books never evict it and it stays out of the book
+// cache counters (stats reports the list with the catalog)
+#define BOOK_LIST_KEY -1
+
+// Book list saved on disk whenever it changes, one file per user (see
+// snapshotPath()), loaded once they enter the library
+#define SNAPSHOT_PREFIX "catalog."
+#define SNAPSHOT_SUFFIX ".snapshot"
+
 // Content type definitions
 #define APP "application/json"
 
@@ -40,67 +66,381 @@
 #define ACCESS "/api/v1/tema/library/access"
 
 // Placeholder values
-#define NO_TOKEN ""
 #define NO_QUERRY ""
 #define NO_CONTENT_TYPE ""
 
 /**
- * Receives a message from the server and stores it in `response`.
+ * Sends a request to the server and stores a view of its reply in `response`.
+ * The connection is taken from the pool on first use, so commands that
+ * are rejected locally never touch the network.
  *
- * @param response Reference to a string where the received response will be stored.
- * @param sockfd   Socket file descriptor for communication.
+ * @param response Filled with the parsed reply, valid until the connection is released.
+ * @param session  Session holding the server host.
+ * @param sockfd   Socket file descriptor for communication (-1 if not yet connected).
+ * @param message  The request message to send.
  */
-void extractServerResponse(std::string &response, int &sockfd) {
-    response = recvServerMessage(sockfd);
-    if (response.empty()) {
+void extractServerResponse(http_response &response, const session &session, int &sockfd, const std::string &message) {
+    if (sockfd < 0) {
+        sockfd = connectionAcquire(session.host.c_str(), PORT_HTTP);
+    }
+
+    http_parser parser;
+    std::string_view raw = exchangeServerMessage(sockfd, message, &parser);
+    response_init(&response, &parser, raw);
+
+    if (raw.empty()) {
         std::cout << "ERROR: No message received from the server!" << std::endl;
     }
 }
 
 /**
- * Parses the JSON response and prints an error message if applicable.
+ * Sends a request to the server and receives only the status line and
+ * headers of its reply. The body is then read piece by piece, through
+ * body_streambuf or extractServerBody(), so it is never held whole.
+ *
+ * @param response Filled with the parsed head, valid until the body is read.
+ * @param parser   Filled with the parser state the body is read with.
+ * @param session  Session holding the server host.
+ * @param sockfd   Socket file descriptor for communication (-1 if not yet connected).
+ * @param message  The request message to send.
+ */
+void extractServerHead(http_response &response, http_parser &parser, const session &session,
+                       int &sockfd, const std::string &message) {
+    if (sockfd < 0) {
+        sockfd = connectionAcquire(session.host.c_str(), PORT_HTTP);
+    }
+
+    std::string_view raw = exchangeServerHead(sockfd, message, &parser);
+    response_init(&response, &parser, raw);
+
+    if (raw.empty()) {
+        std::cout << "ERROR: No message received from the server!" << std::endl;
+    }
+}
+
+/**
+ * Reads the rest of a body whose head came from extractServerHead().
+ *
+ * @param sockfd Socket file descriptor for communication.
+ * @param parser The parser filled by extractServerHead().
+ * @return The body bytes not read yet.
+ */
+std::string extractServerBody(int sockfd, http_parser &parser) {
+    std::string body;
+    for (std::string_view piece = recvServerBody(sockfd, &parser); !piece.empty();
+         piece = recvServerBody(sockfd, &parser)) {
+        body.append(piece);
+    }
+    return body;
+}
+
+/**
+ * Stream buffer over a body that is still arriving: each underflow pulls
+ * the next decoded piece from the socket and drops the previous one, so
+ * a std::istream (and the JSON SAX parser) reads it in constant memory.
+ * Bytes of the body already received (`prefix`) are read first, and the
+ * pieces pulled from the socket are added to `hash`, if given.
+ */
+class body_streambuf : public std::streambuf {
+public:
+    body_streambuf(int sockfd, http_parser &parser, std::string_view prefix = std::string_view(),
+                   hash64_state *hash = NULL)
+        : sockfd(sockfd), parser(parser), prefix(prefix), hash(hash) {}
+
+protected:
+    int_type underflow() override {
+        std::string_view piece = prefix;
+        prefix = std::string_view();
+
+        if (piece.empty()) {
+            piece = recvServerBody(sockfd, &parser);
+            if (piece.empty()) {
+                return traits_type::eof();
+            }
+            if (hash != NULL) {
+                hash64_update(hash, piece.data(), piece.size());
+            }
+        }
+
+        char *data = const_cast<char *>(piece.data());
+        setg(data, data, data + piece.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    int sockfd;
+    http_parser &parser;
+    std::string_view prefix;
+    hash64_state *hash;
+};
+
+// Outcome of decoding a response body
+typedef enum {
+    DECODE_SUCCESS,  // JSON body without an "error" member
+    DECODE_ERROR,    // JSON body carrying an "error" message
+    DECODE_EMPTY,    // no body at all
+    DECODE_INVALID   // body is not valid JSON
+} decode_kind;
+
+// Response body, validated once and classified
+typedef struct {
+    decode_kind kind;
+    json_value json;      // root of the body, read on demand (DECODE_SUCCESS and DECODE_ERROR)
+    std::string error;    // server message (DECODE_ERROR)
+} decoded_response;
+
+/**
+ * Validates a response body exactly once and classifies it, so handlers
+ * branch on the result instead of parsing and checking it themselves.
+ * Nothing else is decoded: handlers read the few fields they need from
+ * `json`, which points into the body and lives as long as it does.
+ *
+ * @param body The response body.
+ * @return The decoded body.
+ */
+decoded_response decodeResponse(std::string_view body) {
+    decoded_response decoded;
+    decoded.kind = DECODE_EMPTY;
+
+    if (body.empty()) {
+        return decoded;
+    }
+
+    decoded.json = json_validate(body);
+    if (decoded.json.type == JSON_NONE) {
+        decoded.kind = DECODE_INVALID;
+        return decoded;
+    }
+
+    json_value error = json_find(decoded.json, "error");
+    if (error.type == JSON_NONE) {
+        decoded.kind = DECODE_SUCCESS;
+        return decoded;
+    }
+
+    decoded.kind = DECODE_ERROR;
+    decoded.error = json_get_text(error);
+    return decoded;
+}
+
+/**
+ * Decodes the body of a response received whole.
+ *
+ * @param response The server response.
+ * @return The decoded body.
+ */
+decoded_response decodeResponse(const http_response &response) {
+    return decodeResponse(response.body);
+}
+
+/**
+ * Prints the error carried by a decoded response, if any.
+ *
+ * @param decoded The decoded body.
+ * @param reply   The extracted HTTP response code.
+ */
+void errorJSONReply(const decoded_response &decoded, const std::string &reply) {
+    if (decoded.kind == DECODE_ERROR) {
+        std::cout << "ERROR: " << reply << " <=> " << decoded.error << std::endl;
+    } else if (decoded.kind == DECODE_INVALID) {
+        std::cout << "ERROR: Failed to parse server response!" << std::endl;
+    }
+}
+
+/**
+ * Finds the value of a cookie set by the server.
  *
- * @param jsonResponse The JSON-formatted error message.
- * @param reply        The extracted HTTP response code.
+ * @param response The server response.
+ * @param name     The cookie name followed by '=' (e.g., "connect.sid=").
+ * @return The "name=value" pair, or an empty view if the cookie was not set.
  */
-void errorJSONReply(std::string &jsonResponse, std::string &reply) {
-    try {
-        nlohmann::json responseJSON = nlohmann::json::parse(jsonResponse);
-        if (responseJSON.contains("error")) {
-            std::cout << "ERROR: " << reply << " <=> " << responseJSON["error"].get<std::string>() << std::endl;
+std::string_view extractSetCookie(const http_response &response, std::string_view name) {
+    for (size_t i = 0; i < response.headers_count; ++i) {
+        const http_field &field = response.headers[i];
+        if (field.name.size() != 10 || strncasecmp(field.name.data(), "Set-Cookie", 10) != 0) {
+            continue;
+        }
+
+        // "name=value; Path=/; HttpOnly" -> "name=value"
+        if (field.value.substr(0, name.size()) == name) {
+            return field.value.substr(0, field.value.find(';'));
+        }
+    }
+    return std::string_view();
+}
+
+/**
+ * Reads the number of seconds of a Cache-Control directive.
+ *
+ * @param directive The directive, e.g. "max-age=60".
+ * @param name      The directive name followed by '=' (e.g., "max-age=").
+ * @param ms        Set to the value in milliseconds if the directive matches.
+ * @return true if the directive is `name` with a valid number.
+ */
+static bool cacheControlSeconds(std::string_view directive, std::string_view name, long *ms) {
+    if (directive.size() <= name.size() || strncasecmp(directive.data(), name.data(), name.size()) != 0) {
+        return false;
+    }
+
+    long seconds = 0;
+    for (char c : directive.substr(name.size())) {
+        if (c < '0' || c > '9' || seconds > 1000000000L) return false;
+        seconds = seconds * 10 + (c - '0');
+    }
+    *ms = seconds * 1000;
+    return true;
+}
+
+/**
+ * Collects the validators and lifetime of a reply: ETag, Last-Modified
+ * and the max-age, no-cache, no-store and stale-while-revalidate
+ * directives of Cache-Control.
+ *
+ * @param response The server response.
+ * @return The validators, with max_age_ms -1 if the server gave no lifetime.
+ */
+cache_validators extractValidators(const http_response &response) {
+    cache_validators validators = cache_validators_init();
+    validators.etag = response_header(&response, "ETag");
+    validators.last_modified = response_header(&response, "Last-Modified");
+
+    std::string_view control = response_header(&response, "Cache-Control");
+    while (!control.empty()) {
+        size_t comma = control.find(',');
+        std::string_view directive = control.substr(0, comma);
+        control = comma == std::string_view::npos ? std::string_view() : control.substr(comma + 1);
+
+        // Trim the spaces around the directive
+        while (!directive.empty() && directive.front() == ' ') directive.remove_prefix(1);
+        while (!directive.empty() && directive.back() == ' ') directive.remove_suffix(1);
+
+        if (directive.size() == 8 && strncasecmp(directive.data(), "no-store", 8) == 0) {
+            validators.no_store = true;
+        } else if (directive.size() == 8 && strncasecmp(directive.data(), "no-cache", 8) == 0) {
+            validators.max_age_ms = 0;
+        } else if (!cacheControlSeconds(directive, "max-age=", &validators.max_age_ms)) {
+            cacheControlSeconds(directive, "stale-while-revalidate=", &validators.stale_ms);
         }
-    } catch (const std::exception &e) {
-        std::cout << "ERROR: Invalid JSON format received!" << std::endl;
     }
+    return validators;
 }
 
+// A revalidation waiting for the background worker
+typedef struct {
+    std::string host;
+    std::string message;
+    reply_cache *cache;
+    long key;
+} revalidation;
+
+// Revalidations queued for the single background worker; a key queued or
+// being revalidated is not queued again, so the queue never outgrows the cache
+static std::mutex revalidation_lock;
+static std::condition_variable revalidation_ready;
+static std::deque<revalidation> revalidation_queue;
+static std::set<long> revalidation_keys;
+static std::thread revalidation_worker;
+static bool revalidation_stop = false;
+
 /**
- * Extracts the HTTP response code from the server response.
+ * Sends one revalidation on its own connection and updates the copy. A
+ * 304 renews it; a new get_book reply, or a 404 for a book deleted
+ * meanwhile, replaces it; anything else drops it, so the next command
+ * fetches it in the foreground. The book list is never parsed here: its
+ * copy is the catalog, which only the command thread touches.
  *
- * @param response The full server response.
- * @return The extracted response code (e.g., "200", "404").
+ * @param job The revalidation.
  */
-std::string extractJSONCode(const std::string &response) {
-    std::string responseCode;
-    std::size_t spacePos = response.find(' ');
-    if (spacePos != std::string::npos) {
-        responseCode = response.substr(spacePos + 1, 3);
+static void revalidate(const revalidation &job) {
+    http_parser parser;
+    http_response response;
+    std::string raw = fetchServerMessage(job.host.c_str(), PORT_HTTP, job.message, &parser);
+    response_init(&response, &parser, raw);
+
+    cache_validators fresh = extractValidators(response);
+    if (response.status == 304 && cache_refresh(job.cache, job.key, &fresh)) {
+        return;
     }
-    return responseCode;
+    decode_kind kind = job.key == BOOK_LIST_KEY ? DECODE_INVALID : decodeResponse(response.body).kind;
+    if ((response.status == 200 && kind == DECODE_SUCCESS) ||
+        (response.status == 404 && kind == DECODE_ERROR)) {
+        cache_put(job.cache, job.key, response.code, response.body, &fresh);
+        return;
+    }
+    cache_invalidate(job.cache, job.key);
 }
 
 /**
- * Extracts the JSON response body from the full HTTP response.
+ * Runs the queued revalidations one after the other until stopped, and
+ * the queue is empty.
+ */
+static void revalidationLoop() {
+    std::unique_lock<std::mutex> guard(revalidation_lock);
+    while (true) {
+        revalidation_ready.wait(guard, [] { return revalidation_stop || !revalidation_queue.empty(); });
+        if (revalidation_queue.empty()) {
+            return;
+        }
+
+        revalidation job = std::move(revalidation_queue.front());
+        revalidation_queue.pop_front();
+        guard.unlock();
+
+        try {
+            revalidate(job);
+        } catch (...) {
+            // The copy stays as it is, and is revalidated again once expired;
+            // nothing thrown here may reach the top of the thread
+        }
+
+        guard.lock();
+        revalidation_keys.erase(job.key);
+    }
+}
+
+/**
+ * Revalidates a stale copy on the background worker while the copy is
+ * being served (stale-while-revalidate). Nothing is queued if the copy
+ * is already waiting for (or undergoing) a revalidation.
  *
- * @param response The full server response.
- * @return The extracted JSON content.
+ * @param session Session holding the server host and credentials.
+ * @param cache   The cache holding the copy.
+ * @param key     Its key: a book id, or BOOK_LIST_KEY.
+ * @param url     The URL it was fetched from.
+ * @param validators Its validators.
+ */
+void revalidateInBackground(const session &session, reply_cache &cache, long key,
+                            std::string_view url, const cache_validators &validators) {
+    std::string message = GET(session, url, NO_QUERRY, validators.etag, validators.last_modified);
+
+    std::lock_guard<std::mutex> guard(revalidation_lock);
+    if (!revalidation_keys.insert(key).second) {
+        return;
+    }
+    revalidation_queue.push_back({session.host, std::move(message), &cache, key});
+
+    // The worker is started on first use, and again after revalidateWait()
+    if (!revalidation_worker.joinable()) {
+        revalidation_stop = false;
+        revalidation_worker = std::thread(revalidationLoop);
+    }
+    revalidation_ready.notify_one();
+}
+
+/**
+ * Waits for every queued revalidation and stops the worker, before the
+ * cache is cleared or the client exits.
  */
-std::string extractJSONResponse(const std::string &response) {
-    std::size_t emptyLinePos = response.find(HEADER_TERMINATOR);
-    if (emptyLinePos != std::string::npos && emptyLinePos + 4 < response.size()) {
-        return response.substr(emptyLinePos + 4);
+void revalidateWait() {
+    {
+        std::lock_guard<std::mutex> guard(revalidation_lock);
+        revalidation_stop = true;
+    }
+    revalidation_ready.notify_one();
+
+    if (revalidation_worker.joinable()) {
+        revalidation_worker.join();
     }
-    return "";
 }
 
 #endif /* RESPONSE_HPP */
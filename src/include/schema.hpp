@@ -0,0 +1,200 @@
+#ifndef SCHEMA_HPP
+#define SCHEMA_HPP
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+// Slots of the perfect-hash key table, a power of two above the field count
+#define SCHEMA_SLOTS 16
+
+// JSON type a field is written as
+typedef enum {
+    FIELD_STRING,
+    FIELD_NUMBER
+} field_kind;
+
+// One field of a record: its JSON key, wire type and the member holding it
+template <typename Record>
+struct schema_field {
+    std::string_view name;
+    field_kind kind;
+    bool optional;                // left out of the output while empty
+    std::string Record::*member;  // stored as text, numbers as written
+};
+
+/**
+ * Hashes a key from its length and its first and last bytes, mixed with
+ * a seed. Used both at compile time, to pick a seed without collisions,
+ * and at run time, to dispatch a key without walking all of it.
+ *
+ * @param key  The key.
+ * @param seed The seed found for the schema.
+ * @return The hash.
+ */
+constexpr unsigned schema_hash(std::string_view key, unsigned seed) {
+    if (key.empty()) return 0;
+    unsigned hash = ((unsigned)key.size() << 16) | ((unsigned)(unsigned char)key.front() << 8) |
+                    (unsigned)(unsigned char)key.back();
+    return (hash * (2654435761u + 2 * seed)) >> 24;
+}
+
+/**
+ * Compile-time description of a record. The constructor searches for a
+ * hash seed that sends every key to its own slot, so looking a key up
+ * costs one hash and one comparison, and decoded values are written
+ * straight into the record's members.
+ */
+template <typename Record, size_t N>
+struct record_schema {
+    static_assert(N <= SCHEMA_SLOTS, "too many fields for SCHEMA_SLOTS");
+
+    schema_field<Record> fields[N];
+    unsigned seed;
+    signed char slots[SCHEMA_SLOTS];  // field number per slot, -1 if free
+
+    constexpr record_schema(const schema_field<Record> (&list)[N]) : fields{}, seed(0), slots{} {
+        for (size_t i = 0; i < N; ++i) {
+            fields[i] = list[i];
+        }
+
+        for (;; ++seed) {
+            bool perfect = true;
+            for (size_t s = 0; s < SCHEMA_SLOTS; ++s) {
+                slots[s] = -1;
+            }
+
+            for (size_t i = 0; i < N && perfect; ++i) {
+                unsigned slot = schema_hash(fields[i].name, seed) & (SCHEMA_SLOTS - 1);
+                if (slots[slot] >= 0) {
+                    perfect = false;
+                } else {
+                    slots[slot] = (signed char)i;
+                }
+            }
+
+            if (perfect) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Finds the field named key.
+     *
+     * @param key The JSON key.
+     * @return The field number, or -1 if the record has no such field.
+     */
+    int find(std::string_view key) const {
+        int field = slots[schema_hash(key, seed) & (SCHEMA_SLOTS - 1)];
+        return (field >= 0 && fields[field].name == key) ? field : -1;
+    }
+};
+
+/**
+ * Counts the bytes a string takes once escaped as JSON (quotes excluded).
+ *
+ * @param text The raw string.
+ * @return The escaped length.
+ */
+size_t schema_escaped_size(std::string_view text) {
+    size_t size = text.size();
+    for (char c : text) {
+        if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            size += 1;
+        } else if ((unsigned char)c < 0x20) {
+            size += 5;
+        }
+    }
+    return size;
+}
+
+/**
+ * Appends a string escaped as JSON (quotes excluded), the way
+ * nlohmann::json::dump() escapes it.
+ *
+ * @param out  The output.
+ * @param text The raw string.
+ */
+void schema_escape(std::string *out, std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    size_t start = 0;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out->append(text.data() + start, i - start);
+        start = i + 1;
+
+        switch (c) {
+            case '"':  out->append("\\\""); break;
+            case '\\': out->append("\\\\"); break;
+            case '\b': out->append("\\b"); break;
+            case '\f': out->append("\\f"); break;
+            case '\n': out->append("\\n"); break;
+            case '\r': out->append("\\r"); break;
+            case '\t': out->append("\\t"); break;
+            default:
+                out->append("\\u00");
+                out->push_back(hex[c >> 4]);
+                out->push_back(hex[c & 0xF]);
+                break;
+        }
+    }
+
+    out->append(text.data() + start, text.size() - start);
+}
+
+/**
+ * Serializes a record as a compact JSON object, fields in schema order.
+ * The exact size is computed first, so the output is written with a
+ * single allocation.
+ *
+ * @param schema The record schema.
+ * @param record The record.
+ * @param out    Replaced with the JSON text.
+ */
+template <typename Record, size_t N>
+void schema_serialize(const record_schema<Record, N> &schema, const Record &record, std::string *out) {
+    size_t size = 2;
+    for (const schema_field<Record> &field : schema.fields) {
+        const std::string &value = record.*field.member;
+        if (field.optional && value.empty()) continue;
+
+        // "name": plus a comma, then the value
+        size += field.name.size() + 4;
+        size += field.kind == FIELD_STRING ? schema_escaped_size(value) + 2 : value.size();
+    }
+
+    out->clear();
+    out->reserve(size);
+    out->push_back('{');
+
+    bool first = true;
+    for (const schema_field<Record> &field : schema.fields) {
+        const std::string &value = record.*field.member;
+        if (field.optional && value.empty()) continue;
+
+        if (!first) out->push_back(',');
+        first = false;
+
+        out->push_back('"');
+        out->append(field.name);
+        out->append("\":");
+
+        if (field.kind == FIELD_STRING) {
+            out->push_back('"');
+            schema_escape(out, value);
+            out->push_back('"');
+        } else {
+            out->append(value);
+        }
+    }
+
+    out->push_back('}');
+}
+
+#endif /* SCHEMA_HPP */
@@ -0,0 +1,89 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <iomanip>
+#include <sstream>
+
+#include "response.hpp"
+#include "../utils/catalog.hpp"
+#include "../utils/aggregate.hpp"
+#include "../utils/query.hpp"
+
+/**
+ * Prints the books of the catalog grouped by author, genre or publisher:
+ * how many each group has, and the sum, min and max of their page counts.
+ *
+ * @param catalog The last book list received.
+ * @param name    The field grouped by.
+ */
+void statsGroups(const catalog &catalog, const std::string &name)
+{
+    int field = query_find_field(name);
+    if (field != QUERY_AUTHOR && field != QUERY_GENRE && field != QUERY_PUBLISHER) {
+        std::cout << "ERROR: Books can be grouped by author, genre or publisher!" << std::endl;
+        return;
+    }
+
+    if (catalog.count == 0) {
+        std::cout << "ERROR: No books kept yet, run get_books first!" << std::endl;
+        return;
+    }
+
+    std::vector<group_stats> groups;
+    aggregate_groups(&catalog, field, 0, &groups);
+
+    std::string label = name;
+    std::transform(label.begin(), label.end(), label.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    std::cout << "Books by " << label << ": " << groups.size()
+              << (groups.size() == 1 ? " group, " : " groups, ") << catalog.count << " books\n";
+    for (const group_stats &group : groups) {
+        std::cout << "- " << (group.value.empty() ? "Unknown" : group.value) << ": " << group.count
+                  << (group.count == 1 ? " book" : " books");
+        if (group.pages > 0) {
+            std::cout << ", page_count sum " << group.sum << ", min " << group.min << ", max " << group.max;
+        }
+        std::cout << '\n';
+    }
+    std::cout << std::flush;
+}
+
+/**
+ * Prints the counters the client keeps about its local data: the
+ * get_book reply cache and the catalog kept from the last get_books.
+ * With a field (e.g. `stats genre`), prints the catalog grouped by it.
+ *
+ * @param cache   Replies of recent get_book lookups.
+ * @param catalog The last book list received.
+ * @param memo    Book list bodies parsed, or recognized as unchanged.
+ * @param field   The field to group the books by, empty for the counters.
+ */
+void stats(reply_cache &cache, const catalog &catalog, const catalog_memo &memo, const std::string &field)
+{
+    if (!field.empty()) {
+        statsGroups(catalog, field);
+        return;
+    }
+
+    // Reply cache counters, with the hit rate over all lookups
+    cache_stats counters = cache_get_stats(&cache);
+    size_t lookups = counters.hits + counters.misses;
+    double rate = lookups == 0 ? 0.0 : 100.0 * counters.hits / lookups;
+
+    // Formatted on its own stream, so std::cout keeps its default notation
+    std::ostringstream percent;
+    percent << std::fixed << std::setprecision(1) << rate;
+
+    std::cout << "Book cache: " << counters.entries << " entries, "
+              << counters.hits << " hits, " << counters.misses << " misses ("
+              << percent.str() << "% hit rate), "
+              << counters.evictions << " evictions, " << counters.invalidations << " invalidations, "
+              << counters.revalidations << " revalidated (304)" << std::endl;
+
+    // Size of the catalog kept in memory
+    std::cout << "Catalog: " << catalog.count << " books, "
+              << catalog_memory(&catalog) << " bytes, "
+              << memo.hits << " unchanged bodies reused, " << memo.misses << " new" << std::endl;
+}
+
+#endif /* STATS_HPP */
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <thread>
+
+#include "aggregate.hpp"
+#include "query.hpp"
+
+// Running totals of one group, as kept by each thread
+typedef struct {
+    uint32_t count;
+    uint32_t pages;
+    long sum;
+    long min;
+    long max;
+} group_partial;
+
+/**
+ * Aggregates a range of books into a partial table. The intern code of a
+ * value is already a perfect hash of it, so the table is indexed by code.
+ * @param codes The column grouped by.
+ * @param page_counts The page count column.
+ * @param begin The first book.
+ * @param end Past the last book.
+ * @param table Zeroed, one entry per intern code.
+ */
+static void aggregate_range(const uint32_t *codes, const long *page_counts, size_t begin, size_t end,
+                            group_partial *table) {
+    for (size_t i = begin; i < end; ++i) {
+        group_partial *group = &table[codes[i]];
+        long pages = page_counts[i];
+        ++group->count;
+
+        if (pages >= 0) {
+            if (group->pages++ == 0) {
+                group->min = pages;
+                group->max = pages;
+            } else {
+                group->min = std::min(group->min, pages);
+                group->max = std::max(group->max, pages);
+            }
+            group->sum += pages;
+        }
+    }
+}
+
+/**
+ * Folds a partial table into another.
+ * @param into The table kept.
+ * @param from The table folded in.
+ * @param size The entries of each table.
+ */
+static void aggregate_merge(group_partial *into, const group_partial *from, size_t size) {
+    for (size_t code = 0; code < size; ++code) {
+        const group_partial *group = &from[code];
+        if (group->pages > 0) {
+            if (into[code].pages == 0) {
+                into[code].min = group->min;
+                into[code].max = group->max;
+            } else {
+                into[code].min = std::min(into[code].min, group->min);
+                into[code].max = std::max(into[code].max, group->max);
+            }
+        }
+        into[code].count += group->count;
+        into[code].pages += group->pages;
+        into[code].sum += group->sum;
+    }
+}
+
+/**
+ * Groups the books by author, genre or publisher. Each thread aggregates
+ * a slice of the catalog into its own table, without locks, and the
+ * tables are merged at the end. A table has an entry per intern code,
+ * so the threads are capped to keep all tables about the size of the
+ * columns scanned.
+ * @param catalog The catalog.
+ * @param field QUERY_AUTHOR, QUERY_GENRE or QUERY_PUBLISHER.
+ * @param threads The threads to use at most, 0 for one per core.
+ * @param groups Replaced with the groups, most books first, then by value.
+ * @return The number of groups, 0 if field cannot be grouped by.
+ */
+size_t aggregate_groups(const catalog *catalog, int field, unsigned threads, std::vector<group_stats> *groups) {
+    groups->clear();
+
+    const uint32_t *codes = field == QUERY_AUTHOR ? catalog->authors.data()
+                          : field == QUERY_GENRE ? catalog->genres.data()
+                          : field == QUERY_PUBLISHER ? catalog->publishers.data()
+                          : NULL;
+    if (codes == NULL || catalog->count == 0) {
+        return 0;
+    }
+
+    size_t count = catalog->count;
+    size_t size = catalog->strings.offsets.size() - 1;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t most = std::min(count / AGGREGATE_MIN_BOOKS, 1 + count / size);
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, most));
+
+    std::vector<std::vector<group_partial>> tables(threads, std::vector<group_partial>(size, group_partial()));
+    std::vector<std::thread> workers;
+    size_t slice = (count + threads - 1) / threads;
+
+    // The calling thread takes the first slice
+    for (unsigned t = 1; t < threads; ++t) {
+        size_t begin = std::min(count, t * slice);
+        size_t end = std::min(count, begin + slice);
+        workers.emplace_back(aggregate_range, codes, catalog->page_counts.data(), begin, end, tables[t].data());
+    }
+    aggregate_range(codes, catalog->page_counts.data(), 0, std::min(count, slice), tables[0].data());
+
+    for (unsigned t = 1; t < threads; ++t) {
+        workers[t - 1].join();
+        aggregate_merge(tables[0].data(), tables[t].data(), size);
+    }
+
+    for (size_t code = 0; code < size; ++code) {
+        const group_partial *group = &tables[0][code];
+        if (group->count == 0) {
+            continue;
+        }
+
+        group_stats stats;
+        stats.value = intern_get(&catalog->strings, (uint32_t)code);
+        stats.count = group->count;
+        stats.pages = group->pages;
+        stats.sum = group->sum;
+        stats.min = group->min;
+        stats.max = group->max;
+        groups->push_back(stats);
+    }
+
+    std::sort(groups->begin(), groups->end(), [](const group_stats &a, const group_stats &b) {
+        return a.count != b.count ? a.count > b.count : a.value < b.value;
+    });
+    return groups->size();
+}
@@ -0,0 +1,28 @@
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <stddef.h>
+#include <string_view>
+#include <vector>
+
+#include "catalog.hpp"
+
+// Books per thread below which a group-by is not split further
+#define AGGREGATE_MIN_BOOKS 65536
+
+// Page-count statistics of the books sharing a value
+typedef struct {
+    std::string_view value;  // the author, genre or publisher, empty if unknown
+    size_t count;            // books
+    size_t pages;            // books with a known page count
+    long sum;                // of the known page counts
+    long min;                // of the known page counts, undefined if pages == 0
+    long max;
+} group_stats;
+
+// Groups the books of catalog by a query_field (QUERY_AUTHOR, QUERY_GENRE or
+// QUERY_PUBLISHER), on up to threads threads (0 for one per core). Fills groups,
+// most books first, and returns their number, or 0 for another field.
+size_t aggregate_groups(const catalog *catalog, int field, unsigned threads, std::vector<group_stats> *groups);
+
+#endif // AGGREGATE_HPP
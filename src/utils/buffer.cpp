@@ -15,6 +15,7 @@ buffer buffer_init(void) {
     buffer buffer;
     buffer.data = NULL;
     buffer.size = 0;
+    buffer.capacity = 0;
     return buffer;
 }
 
@@ -23,93 +24,55 @@ buffer buffer_init(void) {
  * @param buffer The buffer to free.
  */
 void buffer_free(buffer *buffer) {
-    if (buffer->data != NULL) {
+    if (buffer->data != NULL && buffer->data != buffer->small) {
         free(buffer->data);
-        buffer->data = NULL;
     }
+    buffer->data = NULL;
     buffer->size = 0;
+    buffer->capacity = 0;
 }
 
 /**
- * Checks if a buffer is empty.
- * @param buffer The buffer to check.
- * @return 1 if empty, 0 otherwise.
+ * Moves a buffer to storage of exactly `capacity` bytes.
+ * @param buffer The buffer to resize.
+ * @param capacity The new capacity, at least the current size.
  */
-int buffer_is_empty(buffer *buffer) {
-    return (buffer->data == NULL);
-}
-
-/**
- * Adds data to a buffer, resizing as needed.
- * @param buffer The buffer to add data to.
- * @param data The data to add.
- * @param data_size The size of the data.
- */
-void buffer_add(buffer *buffer, const char *data, size_t data_size) {
-    if (data == NULL || data_size == 0) return;
+static void buffer_resize(buffer *buffer, size_t capacity) {
+    // Tiny payloads never touch the heap
+    if (buffer->data == NULL && capacity <= BUFFER_INLINE) {
+        buffer->data = buffer->small;
+        buffer->capacity = BUFFER_INLINE;
+        return;
+    }
 
-    if (buffer->data != NULL) {
-        char *new_data = (char*)realloc(buffer->data, (buffer->size + data_size) * sizeof(char));
-        if (new_data == NULL) {
-            free(buffer->data);
-            error("ERROR: Memory allocation failed");
+    char *new_data;
+    if (buffer->data == NULL || buffer->data == buffer->small) {
+        new_data = (char*)malloc(capacity * sizeof(char));
+        if (new_data != NULL && buffer->size > 0) {
+            memcpy(new_data, buffer->small, buffer->size);
         }
-        buffer->data = new_data;
     } else {
-        buffer->data = (char*)calloc(data_size, sizeof(char));
-        if (buffer->data == NULL) {
-            error("ERROR: Memory allocation failed");
-        }
+        new_data = (char*)realloc(buffer->data, capacity * sizeof(char));
     }
 
-    memcpy(buffer->data + buffer->size, data, data_size);
-    buffer->size += data_size;
-}
-
-/**
- * Finds the first occurrence of `data` in the buffer.
- * @param buffer The buffer to search.
- * @param data The substring to find.
- * @param data_size The length of `data`.
- * @return The position of the match, or -1 if not found.
- */
-int buffer_find(buffer *buffer, const char *data, size_t data_size) {
-    if (buffer->data == NULL || data == NULL || data_size > buffer->size) return -1;
-
-    size_t last_pos = buffer->size - data_size + 1;
-
-    for (size_t i = 0; i < last_pos; ++i) {
-        if (memcmp(buffer->data + i, data, data_size) == 0) {
-            return i;
-        }
+    if (new_data == NULL) {
+        buffer_free(buffer);
+        error("ERROR: Memory allocation failed");
     }
 
-    return -1;
+    buffer->data = new_data;
+    buffer->capacity = capacity;
 }
 
 /**
- * Case-insensitive version of `buffer_find()`.
- * @param buffer The buffer to search.
- * @param data The substring to find.
- * @param data_size The length of `data`.
- * @return The position of the match, or -1 if not found.
+ * Grows a buffer to hold at least `capacity` bytes. No slack is added:
+ * callers growing step by step ask for geometric sizes themselves. A
+ * first reservation that fits BUFFER_INLINE uses the inline storage.
+ * @param buffer The buffer to grow.
+ * @param capacity The minimum capacity.
  */
-int buffer_find_insensitive(buffer *buffer, const char *data, size_t data_size) {
-    if (buffer->data == NULL || data == NULL || data_size > buffer->size) return -1;
-
-    size_t last_pos = buffer->size - data_size + 1;
-
-    for (size_t i = 0; i < last_pos; ++i) {
-        size_t j;
-        for (j = 0; j < data_size; ++j) {
-            if (tolower(buffer->data[i + j]) != tolower(data[j])) {
-                break;
-            }
-        }
-        if (j == data_size) {
-            return i;
-        }
+void buffer_reserve(buffer *buffer, size_t capacity) {
+    if (capacity > buffer->capacity) {
+        buffer_resize(buffer, capacity);
     }
-
-    return -1;
 }
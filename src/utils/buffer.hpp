@@ -4,31 +4,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
-// Buffer structure
+// Bytes stored inline before the first heap allocation: enough for a
+// 304 Not Modified or a short error reply with its headers
+#define BUFFER_INLINE 512
+
+// Buffer structure. Small payloads live in `small`, so once data has
+// been added the buffer must not be copied by value.
 typedef struct {
     char *data;
     size_t size;
+    size_t capacity;
+    char small[BUFFER_INLINE];
 } buffer;
 
 // Initializes a buffer
 buffer buffer_init(void);
 
+// Grows a buffer so it can hold at least capacity bytes
+void buffer_reserve(buffer *buffer, size_t capacity);
+
 // Frees a buffer
 void buffer_free(buffer *buffer);
 
-// Adds data of size data_size to a buffer
-void buffer_add(buffer *buffer, const char *data, size_t data_size);
-
-// Checks if a buffer is empty
-int buffer_is_empty(buffer *buffer);
-
-// Finds data of size data_size in a buffer and returns its position
-int buffer_find(buffer *buffer, const char *data, size_t data_size);
-
-// Finds data of size data_size in a buffer in a
-// case-insensitive fashion and returns its position
-int buffer_find_insensitive(buffer *buffer, const char *data, size_t data_size);
-
 #endif // BUFFER_HPP
@@ -0,0 +1,290 @@
+#include "cache.hpp"
+
+typedef std::chrono::steady_clock cache_clock;
+
+/**
+ * Picks the shard of a key. Ids are often consecutive, so they are mixed
+ * first to spread neighbours over different shards.
+ * @param cache The cache.
+ * @param key The key.
+ * @return The shard.
+ */
+static cache_shard *cache_shard_of(reply_cache *cache, long key) {
+    unsigned long long mixed = (unsigned long long)key * 0x9E3779B97F4A7C15ull;
+    return &cache->shards[(mixed >> 32) % CACHE_SHARDS];
+}
+
+/**
+ * Tells whether a key counts in the statistics. Pinned keys (negative)
+ * belong to their owner, which reports on them itself, so the counters
+ * only measure the lookups of ordinary keys.
+ * @param key The key.
+ * @return true unless the key is pinned.
+ */
+static bool cache_counted(long key) {
+    return key >= 0;
+}
+
+/**
+ * Sets the lifetime of an entry from its validators: max-age if the
+ * server sent one, the cache TTL otherwise, then the stale window.
+ * @param cache The cache.
+ * @param entry The entry.
+ */
+static void cache_renew(reply_cache *cache, cache_entry *entry) {
+    long lifetime = entry->validators.max_age_ms >= 0 ? entry->validators.max_age_ms : cache->ttl_ms;
+    entry->fresh_until = cache_clock::now() + std::chrono::milliseconds(lifetime);
+    entry->stale_until = entry->fresh_until + std::chrono::milliseconds(entry->validators.stale_ms);
+}
+
+/**
+ * Removes an entry from its shard.
+ * @param shard The shard.
+ * @param found The index position of the entry.
+ */
+static void cache_remove(cache_shard *shard, std::unordered_map<long, std::list<cache_entry>::iterator>::iterator found) {
+    shard->lru.erase(found->second);
+    shard->index.erase(found);
+}
+
+/**
+ * Initializes a cache. The capacity is split evenly between the shards.
+ * @param cache The cache.
+ * @param capacity The maximum number of entries.
+ * @param ttl_ms The lifetime of an entry the server gave none, 0 for no expiry.
+ */
+void cache_init(reply_cache *cache, size_t capacity, long ttl_ms) {
+    cache->shard_capacity = capacity < CACHE_SHARDS ? 1 : capacity / CACHE_SHARDS;
+    cache->ttl_ms = ttl_ms;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->invalidations = 0;
+    cache->revalidations = 0;
+    cache_clear(cache);
+}
+
+/**
+ * @return Validators of a reply the server said nothing about.
+ */
+cache_validators cache_validators_init(void) {
+    cache_validators validators;
+    validators.max_age_ms = -1;
+    validators.stale_ms = 0;
+    validators.no_store = false;
+    return validators;
+}
+
+/**
+ * Looks a key up. A fresh or stale copy is a hit and moves the entry to
+ * the front of its shard. An expired copy is kept for a conditional
+ * request if it has validators, and dropped otherwise.
+ * @param cache The cache.
+ * @param key The key.
+ * @param code Set to the cached status code, unless NULL.
+ * @param body Set to the cached body, unless NULL.
+ * @param validators Set to the cached validators, unless NULL.
+ * @return What was found.
+ */
+cache_state cache_get(reply_cache *cache, long key, std::string *code, std::string *body,
+                      cache_validators *validators) {
+    cache_shard *shard = cache_shard_of(cache, key);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    auto found = shard->index.find(key);
+    if (found == shard->index.end()) {
+        if (cache_counted(key)) ++cache->misses;
+        return CACHE_MISS;
+    }
+
+    auto entry = found->second;
+    cache_clock::time_point now = cache_clock::now();
+    cache_state state = CACHE_FRESH;
+
+    if (cache->ttl_ms > 0 || entry->validators.max_age_ms >= 0) {
+        if (now >= entry->stale_until) {
+            state = CACHE_REVALIDATE;
+        } else if (now >= entry->fresh_until) {
+            state = CACHE_STALE;
+        }
+    }
+
+    if (state == CACHE_REVALIDATE && entry->validators.etag.empty() && entry->validators.last_modified.empty()) {
+        cache_remove(shard, found);
+        if (cache_counted(key)) {
+            ++cache->evictions;
+            ++cache->misses;
+        }
+        return CACHE_MISS;
+    }
+
+    shard->lru.splice(shard->lru.begin(), shard->lru, entry);
+    if (code != NULL) *code = entry->code;
+    if (body != NULL) *body = entry->body;
+    if (validators != NULL) *validators = entry->validators;
+
+    if (!cache_counted(key)) {
+        return state;
+    }
+    if (state == CACHE_REVALIDATE) {
+        ++cache->misses;
+    } else {
+        ++cache->hits;
+    }
+    return state;
+}
+
+/**
+ * Stores a reply. An existing entry for the key is replaced. A reply the
+ * server marked no-store, or one that would expire at once with nothing
+ * to revalidate it by, is not kept. Entries of negative keys are pinned:
+ * never evicted to make room, though they still expire.
+ * @param cache The cache.
+ * @param key The key.
+ * @param code The status code of the reply.
+ * @param body The body of the reply.
+ * @param validators The validators of the reply, NULL for none.
+ */
+void cache_put(reply_cache *cache, long key, std::string_view code, std::string_view body,
+               const cache_validators *validators) {
+    cache_validators none = cache_validators_init();
+    if (validators == NULL) {
+        validators = &none;
+    }
+
+    bool expired = validators->max_age_ms == 0 && validators->stale_ms == 0;
+    bool keep = !validators->no_store &&
+                (!expired || !validators->etag.empty() || !validators->last_modified.empty());
+
+    cache_shard *shard = cache_shard_of(cache, key);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    auto found = shard->index.find(key);
+    if (found != shard->index.end()) {
+        cache_remove(shard, found);
+    } else if (keep && shard->lru.size() >= cache->shard_capacity) {
+        // The least recently used entry goes, unless it is pinned
+        for (auto victim = shard->lru.end(); victim != shard->lru.begin();) {
+            if ((--victim)->key >= 0) {
+                shard->index.erase(victim->key);
+                shard->lru.erase(victim);
+                ++cache->evictions;
+                break;
+            }
+        }
+    }
+
+    if (!keep) {
+        return;
+    }
+
+    shard->lru.push_front(cache_entry());
+    cache_entry &entry = shard->lru.front();
+    entry.key = key;
+    entry.code = code;
+    entry.body = body;
+    entry.validators = *validators;
+    cache_renew(cache, &entry);
+    shard->index[key] = shard->lru.begin();
+}
+
+/**
+ * Checks a key the way cache_get() does, for a caller that only wants to
+ * know: neither the counters nor the order of the entries change.
+ * @param cache The cache.
+ * @param key The key.
+ * @return true if the copy of key is fresh.
+ */
+bool cache_fresh(reply_cache *cache, long key) {
+    cache_shard *shard = cache_shard_of(cache, key);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    auto found = shard->index.find(key);
+    if (found == shard->index.end()) {
+        return false;
+    }
+
+    const cache_entry &entry = *found->second;
+    bool expires = cache->ttl_ms > 0 || entry.validators.max_age_ms >= 0;
+    return !expires || cache_clock::now() < entry.fresh_until;
+}
+
+/**
+ * Renews a copy the server confirmed unchanged (304 Not Modified). The
+ * validators and lifetime the 304 carries replace the stored ones.
+ * @param cache The cache.
+ * @param key The key.
+ * @param validators The validators of the 304.
+ * @return false if the copy is gone, so the 304 cannot be served.
+ */
+bool cache_refresh(reply_cache *cache, long key, const cache_validators *validators) {
+    cache_shard *shard = cache_shard_of(cache, key);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    auto found = shard->index.find(key);
+    if (found == shard->index.end()) {
+        return false;
+    }
+
+    cache_entry &entry = *found->second;
+    if (!validators->etag.empty()) entry.validators.etag = validators->etag;
+    if (!validators->last_modified.empty()) entry.validators.last_modified = validators->last_modified;
+    entry.validators.max_age_ms = validators->max_age_ms;
+    entry.validators.stale_ms = validators->stale_ms;
+
+    cache_renew(cache, &entry);
+    if (cache_counted(key)) ++cache->revalidations;
+    return true;
+}
+
+/**
+ * Drops the entry of a key, once the server copy changed.
+ * @param cache The cache.
+ * @param key The key.
+ */
+void cache_invalidate(reply_cache *cache, long key) {
+    cache_shard *shard = cache_shard_of(cache, key);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    auto found = shard->index.find(key);
+    if (found != shard->index.end()) {
+        cache_remove(shard, found);
+        if (cache_counted(key)) ++cache->invalidations;
+    }
+}
+
+/**
+ * Drops every entry.
+ * @param cache The cache.
+ */
+void cache_clear(reply_cache *cache) {
+    for (cache_shard &shard : cache->shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.lru.clear();
+        shard.index.clear();
+    }
+}
+
+/**
+ * Takes a snapshot of the counters. Like the counters, the number of
+ * entries leaves pinned keys out.
+ * @param cache The cache.
+ * @return The counters and the current number of entries.
+ */
+cache_stats cache_get_stats(reply_cache *cache) {
+    cache_stats stats;
+    stats.hits = cache->hits;
+    stats.misses = cache->misses;
+    stats.evictions = cache->evictions;
+    stats.invalidations = cache->invalidations;
+    stats.revalidations = cache->revalidations;
+    stats.entries = 0;
+
+    for (cache_shard &shard : cache->shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const cache_entry &entry : shard.lru) {
+            stats.entries += cache_counted(entry.key);
+        }
+    }
+    return stats;
+}
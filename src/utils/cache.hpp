@@ -0,0 +1,103 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Independent shards, each with its own lock, so threads rarely contend
+#define CACHE_SHARDS 8
+
+// Validators and lifetime a server sent with a reply
+typedef struct {
+    std::string etag;           // ETag, sent back as If-None-Match
+    std::string last_modified;  // Last-Modified, sent back as If-Modified-Since
+    long max_age_ms;            // Cache-Control max-age, -1 if absent (the cache TTL applies)
+    long stale_ms;              // Cache-Control stale-while-revalidate, 0 if absent
+    bool no_store;              // Cache-Control no-store, the reply must not be kept
+} cache_validators;
+
+// What a lookup found
+typedef enum {
+    CACHE_MISS,        // nothing usable: send a plain request
+    CACHE_FRESH,       // the copy can be used as is
+    CACHE_STALE,       // the copy can be used, but should be revalidated in the background
+    CACHE_REVALIDATE   // send a conditional request, the copy is used on 304
+} cache_state;
+
+// Cached reply of one key
+typedef struct {
+    long key;
+    std::string code;    // status code the reply came with
+    std::string body;
+    cache_validators validators;
+    std::chrono::steady_clock::time_point fresh_until;
+    std::chrono::steady_clock::time_point stale_until;  // end of the stale-while-revalidate window
+} cache_entry;
+
+// One shard: entries in recency order (most recent first), indexed by key
+typedef struct {
+    std::mutex lock;
+    std::list<cache_entry> lru;
+    std::unordered_map<long, std::list<cache_entry>::iterator> index;
+} cache_shard;
+
+// Bounded LRU cache of replies, keyed by id and safe to share between threads
+typedef struct {
+    cache_shard shards[CACHE_SHARDS];
+    size_t shard_capacity;               // entries per shard
+    long ttl_ms;                         // lifetime of an entry, 0 for no expiry
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+    std::atomic<size_t> evictions;       // dropped to make room or expired
+    std::atomic<size_t> invalidations;
+    std::atomic<size_t> revalidations;   // copies renewed by a 304
+} reply_cache;
+
+// Snapshot of the counters of a cache
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t invalidations;
+    size_t revalidations;
+    size_t entries;
+} cache_stats;
+
+// Initializes a cache of at most capacity entries, expiring them after ttl_ms (0: never)
+void cache_init(reply_cache *cache, size_t capacity, long ttl_ms);
+
+// Returns validators with no ETag, no Last-Modified and the default lifetime
+cache_validators cache_validators_init(void);
+
+// Looks key up; unless it is a miss, copies the reply and its validators (each may be NULL)
+cache_state cache_get(reply_cache *cache, long key, std::string *code, std::string *body,
+                      cache_validators *validators);
+
+// Stores the reply for key, evicting the least recently used entry of its shard if full.
+// Negative keys are pinned: their entries are never evicted to make room,
+// and they are left out of the counters.
+void cache_put(reply_cache *cache, long key, std::string_view code, std::string_view body,
+               const cache_validators *validators);
+
+// Tells whether key has a copy usable as is, without counting a lookup or touching its recency
+bool cache_fresh(reply_cache *cache, long key);
+
+// Renews the copy of key after a 304, returns false if it is gone
+bool cache_refresh(reply_cache *cache, long key, const cache_validators *validators);
+
+// Drops the reply cached for key, if any
+void cache_invalidate(reply_cache *cache, long key);
+
+// Drops every entry, counters are kept
+void cache_clear(reply_cache *cache);
+
+// Returns the counters of a cache, over the keys that are not pinned
+cache_stats cache_get_stats(reply_cache *cache);
+
+#endif // CACHE_HPP
@@ -0,0 +1,245 @@
+#include <string.h>
+#include <algorithm>
+
+#include "catalog.hpp"
+
+// Index slots per pool, before the first growth
+#define INTERN_SLOTS 64
+
+/**
+ * Hashes a string (FNV-1a).
+ * @param text The string.
+ * @return The hash.
+ */
+static uint32_t intern_hash(std::string_view text) {
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash ^= (unsigned char)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Finds the index slot of a string: the slot holding it, or the free
+ * slot where it would go.
+ * @param pool The pool.
+ * @param text The string.
+ * @return The slot.
+ */
+static size_t intern_slot(const intern_pool *pool, std::string_view text) {
+    size_t mask = pool->table.size() - 1;
+    size_t slot = intern_hash(text) & mask;
+
+    while (pool->table[slot] != 0 && intern_get(pool, pool->table[slot] - 1) != text) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * Doubles the index and re-inserts every code.
+ * @param pool The pool.
+ */
+static void intern_grow(intern_pool *pool) {
+    std::vector<uint32_t> old;
+    old.swap(pool->table);
+    pool->table.assign(old.size() * 2, 0);
+
+    for (uint32_t entry : old) {
+        if (entry != 0) {
+            pool->table[intern_slot(pool, intern_get(pool, entry - 1))] = entry;
+        }
+    }
+}
+
+/**
+ * Initializes a pool. Code INTERN_EMPTY is the empty string.
+ * @return The pool.
+ */
+intern_pool intern_init(void) {
+    intern_pool pool;
+    pool.offsets.push_back(0);
+    pool.offsets.push_back(0);
+    pool.table.assign(INTERN_SLOTS, 0);
+    pool.table[intern_slot(&pool, std::string_view())] = INTERN_EMPTY + 1;
+    return pool;
+}
+
+/**
+ * Returns the code of a string. A string seen before keeps its code, so
+ * a column of repeated values costs 4 bytes per row plus each distinct
+ * value once.
+ * @param pool The pool.
+ * @param text The string.
+ * @return The code.
+ */
+uint32_t intern_add(intern_pool *pool, std::string_view text) {
+    size_t slot = intern_slot(pool, text);
+    if (pool->table[slot] != 0) {
+        return pool->table[slot] - 1;
+    }
+
+    uint32_t code = (uint32_t)pool->offsets.size() - 1;
+    pool->heap.insert(pool->heap.end(), text.begin(), text.end());
+    pool->offsets.push_back((uint32_t)pool->heap.size());
+    pool->table[slot] = code + 1;
+
+    // Keep the index at most half full
+    if (2 * (size_t)pool->offsets.size() > pool->table.size()) {
+        intern_grow(pool);
+    }
+    return code;
+}
+
+/**
+ * Returns the string of a code.
+ * @param pool The pool.
+ * @param code A code returned by intern_add().
+ * @return A view into the pool, valid until the next intern_add().
+ */
+std::string_view intern_get(const intern_pool *pool, uint32_t code) {
+    uint32_t start = pool->offsets[code];
+    return std::string_view(pool->heap.data() + start, pool->offsets[code + 1] - start);
+}
+
+/**
+ * Initializes an empty catalog.
+ * @return The catalog.
+ */
+catalog catalog_init(void) {
+    catalog catalog;
+    catalog.count = 0;
+    catalog.title_offsets.push_back(0);
+    catalog.strings = intern_init();
+    return catalog;
+}
+
+/**
+ * Drops every book. The columns keep their capacity, so refilling a
+ * catalog of the same size allocates nothing.
+ * @param catalog The catalog.
+ */
+void catalog_clear(catalog *catalog) {
+    catalog->count = 0;
+    catalog->ids.clear();
+    catalog->page_counts.clear();
+    catalog->title_offsets.resize(1);
+    catalog->titles.clear();
+    catalog->authors.clear();
+    catalog->genres.clear();
+    catalog->publishers.clear();
+    catalog->strings = intern_init();
+    catalog->id_order.clear();
+}
+
+/**
+ * Appends a book: the title to the title arena, the other strings to
+ * the intern pool, numbers to their dense columns.
+ * @param catalog The catalog.
+ * @param entry The book.
+ * @return The position of the book.
+ */
+size_t catalog_add(catalog *catalog, const catalog_entry *entry) {
+    catalog->ids.push_back(entry->id);
+    catalog->page_counts.push_back(entry->page_count);
+
+    catalog->titles.insert(catalog->titles.end(), entry->title.begin(), entry->title.end());
+    catalog->title_offsets.push_back((uint32_t)catalog->titles.size());
+
+    catalog->authors.push_back(intern_add(&catalog->strings, entry->author));
+    catalog->genres.push_back(intern_add(&catalog->strings, entry->genre));
+    catalog->publishers.push_back(intern_add(&catalog->strings, entry->publisher));
+
+    return catalog->count++;
+}
+
+/**
+ * Builds the id index: every position, sorted by the id it holds.
+ * @param catalog The catalog.
+ */
+void catalog_index(catalog *catalog) {
+    const long *ids = catalog->ids.data();
+    catalog->id_order.resize(catalog->count);
+    for (size_t i = 0; i < catalog->count; ++i) {
+        catalog->id_order[i] = (uint32_t)i;
+    }
+    std::stable_sort(catalog->id_order.begin(), catalog->id_order.end(),
+                     [ids](uint32_t a, uint32_t b) { return ids[a] < ids[b]; });
+}
+
+/**
+ * Finds a book by id: a binary search of the id index once it is built,
+ * a scan of the dense id column otherwise.
+ * @param catalog The catalog.
+ * @param id The book id.
+ * @return The position of the book, or -1 if absent.
+ */
+long catalog_find(const catalog *catalog, long id) {
+    const long *ids = catalog->ids.data();
+    if (catalog->id_order.size() == catalog->count && catalog->count > 0) {
+        auto found = std::lower_bound(catalog->id_order.begin(), catalog->id_order.end(), id,
+                                      [ids](uint32_t i, long key) { return ids[i] < key; });
+        return found != catalog->id_order.end() && ids[*found] == id ? (long)*found : -1;
+    }
+
+    for (size_t i = 0; i < catalog->count; ++i) {
+        if (ids[i] == id) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @param catalog The catalog.
+ * @param i The position of a book.
+ * @return Its title, valid until the catalog changes.
+ */
+std::string_view catalog_title(const catalog *catalog, size_t i) {
+    uint32_t start = catalog->title_offsets[i];
+    return std::string_view(catalog->titles.data() + start, catalog->title_offsets[i + 1] - start);
+}
+
+/**
+ * @param catalog The catalog.
+ * @param i The position of a book.
+ * @return Its author, valid until the catalog changes.
+ */
+std::string_view catalog_author(const catalog *catalog, size_t i) {
+    return intern_get(&catalog->strings, catalog->authors[i]);
+}
+
+/**
+ * @param catalog The catalog.
+ * @param i The position of a book.
+ * @return Its genre, valid until the catalog changes.
+ */
+std::string_view catalog_genre(const catalog *catalog, size_t i) {
+    return intern_get(&catalog->strings, catalog->genres[i]);
+}
+
+/**
+ * @param catalog The catalog.
+ * @param i The position of a book.
+ * @return Its publisher, valid until the catalog changes.
+ */
+std::string_view catalog_publisher(const catalog *catalog, size_t i) {
+    return intern_get(&catalog->strings, catalog->publishers[i]);
+}
+
+/**
+ * Sums the bytes in use by the columns and the intern pool.
+ * @param catalog The catalog.
+ * @return The size in bytes.
+ */
+size_t catalog_memory(const catalog *catalog) {
+    const intern_pool *pool = &catalog->strings;
+    return catalog->ids.size() * sizeof(long) +
+           catalog->page_counts.size() * sizeof(long) +
+           catalog->title_offsets.size() * sizeof(uint32_t) +
+           catalog->titles.size() +
+           (catalog->authors.size() + catalog->genres.size() + catalog->publishers.size()) * sizeof(uint32_t) +
+           pool->heap.size() + (pool->offsets.size() + pool->table.size()) * sizeof(uint32_t) +
+           catalog->id_order.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,84 @@
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+// Code of the empty string in every intern pool
+#define INTERN_EMPTY 0
+
+// Distinct strings stored once, back to back, and referred to by code
+typedef struct {
+    std::vector<char> heap;         // string bytes
+    std::vector<uint32_t> offsets;  // string `code` spans offsets[code]..offsets[code + 1]
+    std::vector<uint32_t> table;    // open-addressing index: code + 1 per slot, 0 if free
+} intern_pool;
+
+// One book as handed to catalog_add(), views are copied
+typedef struct {
+    long id;
+    std::string_view title;
+    std::string_view author;
+    std::string_view genre;
+    std::string_view publisher;
+    long page_count;                // -1 if unknown
+} catalog_entry;
+
+// Books stored column by column
+typedef struct {
+    size_t count;
+    std::vector<long> ids;
+    std::vector<long> page_counts;
+    std::vector<uint32_t> title_offsets;  // title `i` spans title_offsets[i]..title_offsets[i + 1]
+    std::vector<char> titles;             // all titles back to back
+    std::vector<uint32_t> authors;        // codes into `strings`
+    std::vector<uint32_t> genres;
+    std::vector<uint32_t> publishers;
+    intern_pool strings;                  // authors, genres and publishers
+    std::vector<uint32_t> id_order;       // positions sorted by id, used once it covers every book
+} catalog;
+
+// Body the current catalog was parsed from, so an identical one does not replace it
+typedef struct {
+    size_t size;     // body bytes, 0 if no catalog was parsed yet
+    uint64_t hash;   // hash64() of the body
+    size_t hits;     // bodies identical to the last one, answered from the catalog
+    size_t misses;   // bodies that differed from the last one
+} catalog_memo;
+
+// Initializes an intern pool holding only the empty string
+intern_pool intern_init(void);
+
+// Returns the code of a string, adding it to the pool if new
+uint32_t intern_add(intern_pool *pool, std::string_view text);
+
+// Returns the string of a code
+std::string_view intern_get(const intern_pool *pool, uint32_t code);
+
+// Initializes an empty catalog
+catalog catalog_init(void);
+
+// Drops every book, keeping the memory for the next fill
+void catalog_clear(catalog *catalog);
+
+// Appends a book and returns its position
+size_t catalog_add(catalog *catalog, const catalog_entry *entry);
+
+// Sorts the positions by id, so catalog_find() no longer scans
+void catalog_index(catalog *catalog);
+
+// Returns the position of the book with the given id, or -1 if absent
+long catalog_find(const catalog *catalog, long id);
+
+// Column accessors for the book at position i
+std::string_view catalog_title(const catalog *catalog, size_t i);
+std::string_view catalog_author(const catalog *catalog, size_t i);
+std::string_view catalog_genre(const catalog *catalog, size_t i);
+std::string_view catalog_publisher(const catalog *catalog, size_t i);
+
+// Bytes held by the catalog's columns and pool
+size_t catalog_memory(const catalog *catalog);
+
+#endif // CATALOG_HPP
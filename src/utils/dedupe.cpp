@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "dedupe.hpp"
+
+// Shingles of the title and of the author hash differently, by this tag
+#define DEDUPE_TITLE 1
+#define DEDUPE_AUTHOR 2
+
+// A book in an LSH band: the band's values packed, and its position
+typedef struct {
+    uint64_t key;
+    uint32_t row;
+} dedupe_key;
+
+// Two books an LSH band paired, once checked similar enough
+typedef struct {
+    uint32_t first;
+    uint32_t second;
+} dedupe_edge;
+
+/**
+ * Mixes the bits of a value (the SplitMix64 finalizer).
+ * @param x The value.
+ * @return The mixed value.
+ */
+static inline uint64_t dedupe_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Normalizes a text for shingling: ASCII letters in lowercase, digits
+ * kept, every run of other bytes turned into one space, and a space at
+ * both ends so word boundaries make shingles too.
+ * @param text The text.
+ * @param out Replaced with the normalized text, " " if nothing is left.
+ */
+static void dedupe_normalize(std::string_view text, std::string *out) {
+    out->assign(1, ' ');
+    for (unsigned char c : text) {
+        if (c >= 'A' && c <= 'Z') {
+            out->push_back((char)(c + ('a' - 'A')));
+        } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            out->push_back((char)c);
+        } else if (out->back() != ' ') {
+            out->push_back(' ');
+        }
+    }
+    if (out->back() != ' ') {
+        out->push_back(' ');
+    }
+}
+
+/**
+ * Folds the 3-byte shingles of a normalized text into MinHash values.
+ * Each shingle is hashed once; hash function k then maps that hash with
+ * its own multiply-add, keeping the high 32 bits. (Deriving them as
+ * h1 + k * h2 is cheaper but correlates them: a shingle with small h1
+ * and h2 would be the minimum of every function at once.)
+ * @param text The normalized text.
+ * @param tag Keeps title and author shingles apart.
+ * @param multipliers Odd multiplier of each hash function.
+ * @param increments Increment of each hash function.
+ * @param mins The smallest value of each hash function so far.
+ * @return true if the text had any shingle.
+ */
+static bool dedupe_shingles(const std::string &text, uint32_t tag, const uint64_t *multipliers,
+                            const uint64_t *increments, uint32_t *mins) {
+    if (text.size() < 4) {
+        return false;
+    }
+
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        uint64_t shingle = (uint64_t)tag << 24 | (uint64_t)(unsigned char)text[i] << 16 |
+                           (uint64_t)(unsigned char)text[i + 1] << 8 | (unsigned char)text[i + 2];
+        uint64_t hash = dedupe_mix(shingle);
+
+        for (int k = 0; k < DEDUPE_HASHES; ++k) {
+            mins[k] = std::min(mins[k], (uint32_t)((hash * multipliers[k] + increments[k]) >> 32));
+        }
+    }
+    return true;
+}
+
+/**
+ * Computes the signatures of a range of books. A signature keeps the low
+ * 16 bits of each MinHash value: two different minima agree on them once
+ * in 65536, which barely moves the similarity estimate, and a band of
+ * DEDUPE_ROWS values packs into one 64-bit key.
+ * @param catalog The catalog.
+ * @param begin The first book.
+ * @param end Past the last book.
+ * @param signatures DEDUPE_HASHES values per book.
+ * @param valid Set to 0 for a book with neither title nor author, 1 otherwise.
+ */
+static void dedupe_sign(const catalog *catalog, size_t begin, size_t end, uint16_t *signatures, uint8_t *valid) {
+    // The same functions on every thread: they only depend on k
+    uint64_t multipliers[DEDUPE_HASHES];
+    uint64_t increments[DEDUPE_HASHES];
+    for (int k = 0; k < DEDUPE_HASHES; ++k) {
+        multipliers[k] = dedupe_mix(2 * k + 1) | 1;
+        increments[k] = dedupe_mix(2 * k + 2);
+    }
+
+    std::string text;
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t mins[DEDUPE_HASHES];
+        std::fill(mins, mins + DEDUPE_HASHES, UINT32_MAX);
+
+        dedupe_normalize(catalog_title(catalog, i), &text);
+        bool shingled = dedupe_shingles(text, DEDUPE_TITLE, multipliers, increments, mins);
+        dedupe_normalize(catalog_author(catalog, i), &text);
+        shingled |= dedupe_shingles(text, DEDUPE_AUTHOR, multipliers, increments, mins);
+
+        valid[i] = shingled;
+        for (int k = 0; k < DEDUPE_HASHES; ++k) {
+            signatures[i * DEDUPE_HASHES + k] = (uint16_t)mins[k];
+        }
+    }
+}
+
+/**
+ * @param a The signature of a book.
+ * @param b The signature of another.
+ * @return true if enough of their values agree.
+ */
+static bool dedupe_similar(const uint16_t *a, const uint16_t *b) {
+    int equal = 0;
+    for (int k = 0; k < DEDUPE_HASHES; ++k) {
+        equal += a[k] == b[k];
+    }
+    return equal >= DEDUPE_THRESHOLD * DEDUPE_HASHES;
+}
+
+/**
+ * Buckets the books by one LSH band: sorting them by the packed band
+ * values puts each bucket together. A bucket keeps up to
+ * DEDUPE_REPRESENTATIVES books no earlier one was similar to; every book
+ * is checked against each of them, and becomes one itself if none
+ * matches. Books similar to each other but not to the first of their
+ * bucket are thus still paired, and a bucket costs its size times a
+ * constant, never the square of it. Only once a bucket holds that many
+ * unrelated books does a later one go unchecked against the books it
+ * alone resembles, and then only in this band.
+ * @param signatures The signatures.
+ * @param valid Which books have one.
+ * @param count The number of books.
+ * @param band The band.
+ * @param keys Scratch space.
+ * @param edges Given the pairs found similar.
+ */
+static void dedupe_band(const uint16_t *signatures, const uint8_t *valid, size_t count, int band,
+                        std::vector<dedupe_key> *keys, std::vector<dedupe_edge> *edges) {
+    keys->clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+
+        const uint16_t *values = &signatures[i * DEDUPE_HASHES + band * DEDUPE_ROWS];
+        uint64_t key = 0;
+        for (int r = 0; r < DEDUPE_ROWS; ++r) {
+            key = key << 16 | values[r];
+        }
+        keys->push_back({key, (uint32_t)i});
+    }
+
+    std::sort(keys->begin(), keys->end(), [](const dedupe_key &a, const dedupe_key &b) {
+        return a.key != b.key ? a.key < b.key : a.row < b.row;
+    });
+
+    uint32_t representatives[DEDUPE_REPRESENTATIVES];
+    for (size_t start = 0, end; start < keys->size(); start = end) {
+        size_t kept = 0;
+        representatives[kept++] = (*keys)[start].row;
+
+        for (end = start + 1; end < keys->size() && (*keys)[end].key == (*keys)[start].key; ++end) {
+            uint32_t other = (*keys)[end].row;
+            const uint16_t *signature = &signatures[(size_t)other * DEDUPE_HASHES];
+
+            // Paired with every representative it resembles, so their clusters merge too
+            bool paired = false;
+            for (size_t r = 0; r < kept; ++r) {
+                if (dedupe_similar(&signatures[(size_t)representatives[r] * DEDUPE_HASHES], signature)) {
+                    edges->push_back({representatives[r], other});
+                    paired = true;
+                }
+            }
+            if (!paired && kept < DEDUPE_REPRESENTATIVES) {
+                representatives[kept++] = other;
+            }
+        }
+    }
+}
+
+/**
+ * Finds the set of a book, flattening the path on the way (path halving).
+ * @param parent The parent of each book, itself for a set's root.
+ * @param row The book.
+ * @return The root of its set.
+ */
+static uint32_t dedupe_root(std::vector<uint32_t> *parent, uint32_t row) {
+    while ((*parent)[row] != row) {
+        (*parent)[row] = (*parent)[(*parent)[row]];
+        row = (*parent)[row];
+    }
+    return row;
+}
+
+/**
+ * Finds clusters of likely duplicates. Signatures are computed on every
+ * thread, each taking a slice of the catalog; then each thread buckets
+ * the books by its share of the LSH bands. The similar pairs found are
+ * merged into clusters with a union-find. Nothing compares all pairs:
+ * the work grows with the books and the size of the buckets.
+ * @param catalog The catalog.
+ * @param threads The threads to use at most, 0 for one per core.
+ * @param clusters Replaced with the clusters of two books or more.
+ * @return The number of clusters.
+ */
+size_t dedupe_clusters(const catalog *catalog, unsigned threads, std::vector<std::vector<uint32_t>> *clusters) {
+    clusters->clear();
+    size_t count = catalog->count;
+    if (count < 2) {
+        return 0;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, count / DEDUPE_MIN_BOOKS));
+
+    std::vector<uint16_t> signatures(count * DEDUPE_HASHES);
+    std::vector<uint8_t> valid(count);
+    std::vector<std::thread> workers;
+
+    // Signatures: one slice per thread, the calling thread taking the first
+    size_t slice = (count + threads - 1) / threads;
+    for (unsigned t = 1; t < threads; ++t) {
+        size_t begin = std::min(count, t * slice);
+        workers.emplace_back(dedupe_sign, catalog, begin, std::min(count, begin + slice),
+                             signatures.data(), valid.data());
+    }
+    dedupe_sign(catalog, 0, std::min(count, slice), signatures.data(), valid.data());
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // Bands: thread t takes bands t, t + bands_threads, ...
+    unsigned band_threads = std::min<unsigned>(threads, DEDUPE_BANDS);
+    std::vector<std::vector<dedupe_edge>> edges(band_threads);
+    auto bucket = [&](unsigned t) {
+        std::vector<dedupe_key> keys;
+        for (int band = (int)t; band < DEDUPE_BANDS; band += (int)band_threads) {
+            dedupe_band(signatures.data(), valid.data(), count, band, &keys, &edges[t]);
+        }
+    };
+    for (unsigned t = 1; t < band_threads; ++t) {
+        workers.emplace_back(bucket, t);
+    }
+    bucket(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Clusters: the sets the similar pairs join
+    std::vector<uint32_t> parent(count);
+    for (size_t i = 0; i < count; ++i) {
+        parent[i] = (uint32_t)i;
+    }
+    for (const std::vector<dedupe_edge> &found : edges) {
+        for (const dedupe_edge &edge : found) {
+            uint32_t a = dedupe_root(&parent, edge.first);
+            uint32_t b = dedupe_root(&parent, edge.second);
+            if (a != b) {
+                parent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    }
+
+    // Gather the books of each set of two or more, in catalog order
+    std::vector<uint32_t> sizes(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++sizes[dedupe_root(&parent, (uint32_t)i)];
+    }
+
+    std::vector<uint32_t> cluster_of(count, UINT32_MAX);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t root = dedupe_root(&parent, (uint32_t)i);
+        if (sizes[root] < 2) {
+            continue;
+        }
+        if (cluster_of[root] == UINT32_MAX) {
+            cluster_of[root] = (uint32_t)clusters->size();
+            clusters->emplace_back();
+            clusters->back().reserve(sizes[root]);
+        }
+        (*clusters)[cluster_of[root]].push_back((uint32_t)i);
+    }
+
+    std::stable_sort(clusters->begin(), clusters->end(),
+                     [](const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) { return a.size() > b.size(); });
+    return clusters->size();
+}
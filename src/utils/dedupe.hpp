@@ -0,0 +1,32 @@
+#ifndef DEDUPE_HPP
+#define DEDUPE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "catalog.hpp"
+
+// MinHash values per book, split into LSH bands of DEDUPE_ROWS values each;
+// books sharing a whole band become candidates
+#define DEDUPE_HASHES 32
+#define DEDUPE_ROWS 4
+#define DEDUPE_BANDS (DEDUPE_HASHES / DEDUPE_ROWS)
+
+// Share of equal MinHash values (the estimated Jaccard similarity of the
+// shingle sets) a candidate needs to join a cluster
+#define DEDUPE_THRESHOLD 0.6
+
+// Books of an LSH bucket that every other book of it is checked against
+#define DEDUPE_REPRESENTATIVES 8
+
+// Books per thread below which signatures are not computed in parallel
+#define DEDUPE_MIN_BOOKS 65536
+
+// Finds books that look like duplicates of each other, comparing the 3-byte
+// shingles of their normalized title and author by MinHash and LSH, on up to
+// threads threads (0 for one per core). Fills clusters with the positions of
+// their books in catalog order, largest cluster first, and returns their number.
+size_t dedupe_clusters(const catalog *catalog, unsigned threads, std::vector<std::vector<uint32_t>> *clusters);
+
+#endif // DEDUPE_HPP
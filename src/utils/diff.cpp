@@ -0,0 +1,77 @@
+#include "diff.hpp"
+#include "query.hpp"
+
+/**
+ * Finds the fields in which two books differ. Strings are compared as
+ * is: intern codes cannot be, they belong to different pools.
+ * @param before The older catalog.
+ * @param i The position of the book in it.
+ * @param after The newer catalog.
+ * @param j The position of the book in it.
+ * @return 1 << query_field of each field that differs, 0 if none.
+ */
+static unsigned diff_fields(const catalog *before, size_t i, const catalog *after, size_t j) {
+    unsigned fields = 0;
+    if (before->page_counts[i] != after->page_counts[j]) fields |= 1u << QUERY_PAGE_COUNT;
+    if (catalog_title(before, i) != catalog_title(after, j)) fields |= 1u << QUERY_TITLE;
+    if (catalog_author(before, i) != catalog_author(after, j)) fields |= 1u << QUERY_AUTHOR;
+    if (catalog_genre(before, i) != catalog_genre(after, j)) fields |= 1u << QUERY_GENRE;
+    if (catalog_publisher(before, i) != catalog_publisher(after, j)) fields |= 1u << QUERY_PUBLISHER;
+    return fields;
+}
+
+/**
+ * Compares two catalogs with a merge of their id indexes: one pass over
+ * both, in increasing id order, and nothing allocated. Books sharing an
+ * id are paired in index order; those left over are added or removed.
+ * @param before The older catalog, indexed.
+ * @param after The newer catalog, indexed.
+ * @param visit Called for each book that differs, unless NULL.
+ * @param context Passed to visit.
+ * @return The number of books of each kind.
+ */
+diff_counts catalog_diff(const catalog *before, const catalog *after, diff_visit visit, void *context) {
+    diff_counts counts = {0, 0, 0, 0};
+    const uint32_t *old_order = before->id_order.data();
+    const uint32_t *new_order = after->id_order.data();
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < before->count || j < after->count) {
+        diff_change change;
+        change.before = -1;
+        change.after = -1;
+        change.fields = 0;
+
+        long old_id = i < before->count ? before->ids[old_order[i]] : 0;
+        long new_id = j < after->count ? after->ids[new_order[j]] : 0;
+
+        if (j == after->count || (i < before->count && old_id < new_id)) {
+            change.kind = DIFF_REMOVED;
+            change.id = old_id;
+            change.before = old_order[i++];
+            ++counts.removed;
+        } else if (i == before->count || new_id < old_id) {
+            change.kind = DIFF_ADDED;
+            change.id = new_id;
+            change.after = new_order[j++];
+            ++counts.added;
+        } else {
+            change.kind = DIFF_MODIFIED;
+            change.id = new_id;
+            change.before = old_order[i++];
+            change.after = new_order[j++];
+            change.fields = diff_fields(before, change.before, after, change.after);
+            if (change.fields == 0) {
+                ++counts.unchanged;
+                continue;
+            }
+            ++counts.modified;
+        }
+
+        if (visit != NULL) {
+            visit(context, &change);
+        }
+    }
+    return counts;
+}
@@ -0,0 +1,39 @@
+#ifndef DIFF_HPP
+#define DIFF_HPP
+
+#include <stddef.h>
+
+#include "catalog.hpp"
+
+// How a book differs between two catalogs
+typedef enum {
+    DIFF_ADDED,      // only in the newer catalog
+    DIFF_REMOVED,    // only in the older catalog
+    DIFF_MODIFIED    // in both, with other content
+} diff_kind;
+
+// One book that differs, handed to a diff_visit callback
+typedef struct {
+    diff_kind kind;
+    long id;
+    long before;        // position in the older catalog, -1 if added
+    long after;         // position in the newer catalog, -1 if removed
+    unsigned fields;    // 1 << query_field of each field that differs, if modified
+} diff_change;
+
+// Books of each kind found by catalog_diff()
+typedef struct {
+    size_t added;
+    size_t removed;
+    size_t modified;
+    size_t unchanged;
+} diff_counts;
+
+// Called for each book that differs, in increasing id order
+typedef void (*diff_visit)(void *context, const diff_change *change);
+
+// Compares two catalogs book by book, matching them by id. Both must be
+// indexed (catalog_index()). Calls visit, unless NULL, for every change.
+diff_counts catalog_diff(const catalog *before, const catalog *after, diff_visit visit, void *context);
+
+#endif // DIFF_HPP
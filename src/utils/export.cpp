@@ -0,0 +1,221 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <algorithm>
+
+#include "export.hpp"
+#include "hash.hpp"
+#include "helpers.hpp"
+
+// Sections start on this boundary, so the arrays can be read in place
+#define EXPORT_ALIGN 8
+
+// Bytes of zero padding written after a section
+static const char export_padding[EXPORT_ALIGN] = {0};
+
+// A dictionary-encoded string column, built for the export
+typedef struct {
+    std::vector<uint32_t> codes;     // per row
+    std::vector<uint32_t> offsets;   // per entry, entries + 1
+    std::vector<char> bytes;
+} export_dictionary;
+
+// A run of bytes to write, and the header fields recording where it went
+typedef struct {
+    const void *data;
+    uint64_t size;
+    uint64_t *offset;
+    uint64_t *size_field;
+} export_section;
+
+/**
+ * Describes a numeric column: unknown values (-1) count as nulls, the
+ * others give the min and max.
+ * @param values The column.
+ * @param count The number of rows.
+ * @param column Its descriptor.
+ */
+static void export_numbers(const long *values, size_t count, export_column *column) {
+    column->type = EXPORT_INT64;
+    column->min = -1;
+    column->max = -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        long value = values[i];
+        if (value < 0) {
+            ++column->nulls;
+        } else if (column->min < 0) {
+            column->min = value;
+            column->max = value;
+        } else {
+            column->min = std::min<int64_t>(column->min, value);
+            column->max = std::max<int64_t>(column->max, value);
+        }
+    }
+}
+
+/**
+ * Records the length of a string value in the stats of its column.
+ * @param size The length.
+ * @param rows The rows holding the value.
+ * @param column The descriptor.
+ */
+static void export_length(size_t size, size_t rows, export_column *column) {
+    if (size == 0) {
+        column->nulls += rows;
+    } else if (column->min < 0) {
+        column->min = (int64_t)size;
+        column->max = (int64_t)size;
+    } else {
+        column->min = std::min<int64_t>(column->min, size);
+        column->max = std::max<int64_t>(column->max, size);
+    }
+}
+
+/**
+ * Dictionary-encodes an interned column. The intern pool is shared by
+ * several columns and ordered by first use; the dictionary keeps only
+ * the values of this column, sorted bytewise, so a range of values is
+ * a range of codes.
+ * @param pool The intern pool.
+ * @param codes The column, as pool codes.
+ * @param count The number of rows.
+ * @param dictionary Filled with the encoded column.
+ * @param column Its descriptor.
+ */
+static void export_encode(const intern_pool *pool, const uint32_t *codes, size_t count,
+                          export_dictionary *dictionary, export_column *column) {
+    column->type = EXPORT_DICTIONARY;
+    column->min = -1;
+    column->max = -1;
+
+    // Rows per pool code, then the codes used, sorted by their string
+    std::vector<uint32_t> rows(pool->offsets.size() - 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++rows[codes[i]];
+    }
+
+    std::vector<uint32_t> used;
+    for (uint32_t code = 0; code < rows.size(); ++code) {
+        if (rows[code] > 0) {
+            used.push_back(code);
+        }
+    }
+    std::sort(used.begin(), used.end(), [pool](uint32_t a, uint32_t b) {
+        return intern_get(pool, a) < intern_get(pool, b);
+    });
+
+    // The entries, with the pool code of each mapped to its entry
+    std::vector<uint32_t> remap(rows.size(), 0);
+    dictionary->offsets.assign(1, 0);
+    for (size_t entry = 0; entry < used.size(); ++entry) {
+        std::string_view value = intern_get(pool, used[entry]);
+        dictionary->bytes.insert(dictionary->bytes.end(), value.begin(), value.end());
+        dictionary->offsets.push_back((uint32_t)dictionary->bytes.size());
+        remap[used[entry]] = (uint32_t)entry;
+        export_length(value.size(), rows[used[entry]], column);
+    }
+    column->entries = used.size();
+
+    dictionary->codes.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        dictionary->codes[i] = remap[codes[i]];
+    }
+}
+
+/**
+ * Writes a columnar export: a header describing each column, then the
+ * column sections, ready to be mapped and scanned. Numbers are written
+ * as the catalog holds them, titles as its offsets and bytes, and the
+ * interned columns re-encoded with a sorted dictionary each.
+ * @param path The file.
+ * @param catalog The catalog.
+ * @return The size of the file, 0 on failure.
+ */
+size_t export_columnar(const char *path, const catalog *catalog) {
+    static_assert(sizeof(long) == sizeof(int64_t), "numeric columns are written as int64");
+
+    size_t count = catalog->count;
+    export_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EXPORT_MAGIC, sizeof(header.magic));
+    header.version = EXPORT_VERSION;
+    header.endian = EXPORT_ENDIAN;
+    header.rows = count;
+    header.columns = QUERY_FIELDS;
+
+    export_dictionary dictionaries[QUERY_FIELDS];
+    std::vector<export_section> sections;
+
+    for (int field = 0; field < QUERY_FIELDS; ++field) {
+        export_column *column = &header.column[field];
+        strncpy(column->name, query_field_name(field), sizeof(column->name) - 1);
+
+        if (field == QUERY_ID || field == QUERY_PAGE_COUNT) {
+            const long *values = field == QUERY_ID ? catalog->ids.data() : catalog->page_counts.data();
+            export_numbers(values, count, column);
+            sections.push_back({values, count * sizeof(int64_t), &column->values, &column->values_size});
+        } else if (field == QUERY_TITLE) {
+            column->type = EXPORT_STRING;
+            column->min = -1;
+            column->max = -1;
+            for (size_t i = 0; i < count; ++i) {
+                export_length(catalog->title_offsets[i + 1] - catalog->title_offsets[i], 1, column);
+            }
+            sections.push_back({catalog->title_offsets.data(), (count + 1) * sizeof(uint32_t),
+                                &column->values, &column->values_size});
+            sections.push_back({catalog->titles.data(), catalog->titles.size(), &column->bytes, &column->bytes_size});
+        } else {
+            const uint32_t *codes = field == QUERY_AUTHOR ? catalog->authors.data()
+                                  : field == QUERY_GENRE ? catalog->genres.data()
+                                  : catalog->publishers.data();
+            export_dictionary *dictionary = &dictionaries[field];
+            export_encode(&catalog->strings, codes, count, dictionary, column);
+            sections.push_back({dictionary->codes.data(), dictionary->codes.size() * sizeof(uint32_t),
+                                &column->values, &column->values_size});
+            sections.push_back({dictionary->offsets.data(), dictionary->offsets.size() * sizeof(uint32_t),
+                                &column->offsets, &column->offsets_size});
+            sections.push_back({dictionary->bytes.data(), dictionary->bytes.size(), &column->bytes, &column->bytes_size});
+        }
+    }
+
+    uint64_t offset = sizeof(header);
+    for (export_section &section : sections) {
+        *section.offset = offset;
+        *section.size_field = section.size;
+        offset += (section.size + EXPORT_ALIGN - 1) & ~(uint64_t)(EXPORT_ALIGN - 1);
+    }
+
+    std::string temporary = std::string(path) + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // Sections first, after room for the header, which holds their checksum
+    hash64_state hash;
+    hash64_init(&hash, 0);
+    bool ok = lseek(fd, sizeof(header), SEEK_SET) == (off_t)sizeof(header);
+
+    for (size_t i = 0; ok && i < sections.size(); ++i) {
+        if (sections[i].size == 0) {
+            // An empty vector may have no storage at all
+            continue;
+        }
+        size_t padding = (EXPORT_ALIGN - sections[i].size % EXPORT_ALIGN) % EXPORT_ALIGN;
+        ok = writeAll(fd, sections[i].data, sections[i].size) && writeAll(fd, export_padding, padding);
+        hash64_update(&hash, sections[i].data, sections[i].size);
+        hash64_update(&hash, export_padding, padding);
+    }
+
+    header.checksum = hash64_digest(&hash);
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(temporary.c_str(), path) != 0) {
+        unlink(temporary.c_str());
+        return 0;
+    }
+    return (size_t)offset;
+}
@@ -0,0 +1,59 @@
+#ifndef EXPORT_HPP
+#define EXPORT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "catalog.hpp"
+#include "query.hpp"
+
+// First bytes of every columnar export
+#define EXPORT_MAGIC "BOOKCOLS"
+
+// Bumped whenever the layout below changes
+#define EXPORT_VERSION 1
+
+// Written as is, read back differently on a machine of the other byte order
+#define EXPORT_ENDIAN 0x01020304u
+
+// Encoding of a column
+typedef enum {
+    EXPORT_INT64,       // values: int64 per row, -1 if unknown
+    EXPORT_STRING,      // values: uint32 offsets into bytes, rows + 1; row i spans values[i]..values[i + 1]
+    EXPORT_DICTIONARY   // values: uint32 code per row; entry c spans offsets[c]..offsets[c + 1] of bytes
+} export_type;
+
+// Where a column lies in the file and what it holds; offsets are from the
+// start of the file, each section aligned to 8 bytes
+typedef struct {
+    char name[16];              // nul-padded, e.g. "page_count"
+    uint32_t type;              // export_type
+    uint32_t reserved;
+    uint64_t values;            // section of the row values
+    uint64_t values_size;       // in bytes
+    uint64_t offsets;           // EXPORT_DICTIONARY: uint32 entry offsets, entries + 1
+    uint64_t offsets_size;
+    uint64_t bytes;             // EXPORT_STRING, EXPORT_DICTIONARY: string bytes
+    uint64_t bytes_size;
+    uint64_t entries;           // EXPORT_DICTIONARY: distinct values, sorted bytewise so codes compare like them
+    uint64_t nulls;             // rows without a value (-1 or empty)
+    int64_t min;                // EXPORT_INT64: smallest known value; strings: shortest non-empty length
+    int64_t max;                // largest, likewise; both -1 if every row is null
+} export_column;
+
+// Fixed-size file header, the sections follow
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t checksum;          // hash64() of every byte after the header
+    uint64_t rows;              // books
+    uint64_t columns;           // QUERY_FIELDS, in query_field order
+    export_column column[QUERY_FIELDS];
+} export_header;
+
+// Writes the catalog to path as a columnar file, atomically (written to a
+// temporary file, synced and renamed). Returns the size of the file, 0 on failure.
+size_t export_columnar(const char *path, const catalog *catalog);
+
+#endif // EXPORT_HPP
@@ -0,0 +1,170 @@
+#include <string.h>
+
+#include "hash.hpp"
+
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+// Bytes consumed by one round of the four lanes
+#define HASH_STRIPE 32
+
+static inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t hash64_round(uint64_t lane, uint64_t input) {
+    lane += input * PRIME64_2;
+    return rotl64(lane, 31) * PRIME64_1;
+}
+
+static inline uint64_t hash64_merge(uint64_t hash, uint64_t lane) {
+    hash ^= hash64_round(0, lane);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * Feeds whole stripes to the lanes. The four lanes are independent, so
+ * their multiplies overlap in the pipeline.
+ * @param lanes The accumulators.
+ * @param p The stripes.
+ * @param stripes The number of stripes.
+ */
+static void hash64_stripes(uint64_t lanes[4], const unsigned char *p, size_t stripes) {
+    uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+    for (size_t i = 0; i < stripes; ++i, p += HASH_STRIPE) {
+        v1 = hash64_round(v1, read64(p));
+        v2 = hash64_round(v2, read64(p + 8));
+        v3 = hash64_round(v3, read64(p + 16));
+        v4 = hash64_round(v4, read64(p + 24));
+    }
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+}
+
+/**
+ * Starts a hash.
+ * @param state The state.
+ * @param seed The seed.
+ */
+void hash64_init(hash64_state *state, uint64_t seed) {
+    state->total = 0;
+    state->lanes[0] = seed + PRIME64_1 + PRIME64_2;
+    state->lanes[1] = seed + PRIME64_2;
+    state->lanes[2] = seed;
+    state->lanes[3] = seed - PRIME64_1;
+    state->tail_size = 0;
+    state->seed = seed;
+}
+
+/**
+ * Adds bytes to a hash. Whole stripes are hashed straight from data,
+ * only a partial stripe at either end goes through the tail.
+ * @param state The state.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ */
+void hash64_update(hash64_state *state, const void *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    state->total += size;
+
+    // Complete the stripe left over by the previous update
+    if (state->tail_size > 0) {
+        size_t take = HASH_STRIPE - state->tail_size;
+        if (take > size) take = size;
+
+        memcpy(state->tail + state->tail_size, p, take);
+        state->tail_size += take;
+        p += take;
+        size -= take;
+
+        if (state->tail_size < HASH_STRIPE) {
+            return;
+        }
+        hash64_stripes(state->lanes, state->tail, 1);
+        state->tail_size = 0;
+    }
+
+    size_t stripes = size / HASH_STRIPE;
+    hash64_stripes(state->lanes, p, stripes);
+    p += stripes * HASH_STRIPE;
+    size -= stripes * HASH_STRIPE;
+
+    memcpy(state->tail, p, size);
+    state->tail_size = size;
+}
+
+/**
+ * Finishes a copy of the hash: merges the lanes, then mixes in the tail.
+ * @param state The state.
+ * @return The hash.
+ */
+uint64_t hash64_digest(const hash64_state *state) {
+    uint64_t hash;
+    if (state->total >= HASH_STRIPE) {
+        const uint64_t *v = state->lanes;
+        hash = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            hash = hash64_merge(hash, v[i]);
+        }
+    } else {
+        hash = state->seed + PRIME64_5;
+    }
+    hash += state->total;
+
+    const unsigned char *p = state->tail;
+    size_t size = state->tail_size;
+
+    for (; size >= 8; p += 8, size -= 8) {
+        hash ^= hash64_round(0, read64(p));
+        hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (size >= 4) {
+        hash ^= (uint64_t)read32(p) * PRIME64_1;
+        hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        size -= 4;
+    }
+    for (; size > 0; ++p, --size) {
+        hash ^= *p * PRIME64_5;
+        hash = rotl64(hash, 11) * PRIME64_1;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * Hashes bytes at once.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @param seed The seed.
+ * @return The hash.
+ */
+uint64_t hash64(const void *data, size_t size, uint64_t seed) {
+    hash64_state state;
+    hash64_init(&state, seed);
+    hash64_update(&state, data, size);
+    return hash64_digest(&state);
+}
@@ -0,0 +1,28 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental 64-bit hash (XXH64), for data that arrives in pieces
+typedef struct {
+    uint64_t total;           // bytes hashed so far
+    uint64_t lanes[4];        // accumulators of the 32-byte stripes
+    unsigned char tail[32];   // bytes not making up a whole stripe yet
+    size_t tail_size;
+    uint64_t seed;
+} hash64_state;
+
+// Starts a hash with the given seed
+void hash64_init(hash64_state *state, uint64_t seed);
+
+// Adds size bytes of data to the hash
+void hash64_update(hash64_state *state, const void *data, size_t size);
+
+// Returns the hash of the bytes added so far, the state can keep growing
+uint64_t hash64_digest(const hash64_state *state);
+
+// Hashes size bytes of data at once
+uint64_t hash64(const void *data, size_t size, uint64_t seed);
+
+#endif // HASH_HPP
@@ -6,7 +6,9 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <errno.h>
 #include <stdexcept>
+#include <list>
 
 #include "helpers.hpp"
 #include "buffer.hpp"
@@ -16,15 +18,120 @@ inline void error(const char *msg) {
     throw std::runtime_error(msg);
 }
 
+// Keep-alive connection tracked by the pool
+typedef struct {
+    int sockfd;
+    std::string host;
+    int portno;
+    bool idle;     // parked in the pool, waiting for the next command
+    bool reused;   // handed out at least once before the current command
+    bool reusable; // false once the server closed or will close it
+    buffer rx;     // receive buffer, read() into directly
+    size_t rx_end; // end of the last response handed out, leftovers follow
+    size_t rx_body;  // body bytes handed out by recvServerBody(), dropped on the next call
+    bool streaming;  // a body is still being read by recvServerBody()
+} pooled_connection;
+
+// A list keeps entries in place, since `rx` may point into itself
+static std::list<pooled_connection> pool;
+
+/**
+ * Finds the pool entry of a socket.
+ *
+ * @param sockfd The socket file descriptor.
+ * @return Iterator to the entry, or pool.end() if the socket is not pooled.
+ */
+static std::list<pooled_connection>::iterator connectionLookup(int sockfd) {
+    for (auto it = pool.begin(); it != pool.end(); ++it) {
+        if (it->sockfd == sockfd) {
+            return it;
+        }
+    }
+    return pool.end();
+}
+
+/**
+ * Finds the pool entry of a socket.
+ *
+ * @param sockfd The socket file descriptor.
+ * @return Pointer to the entry, or NULL if the socket is not pooled.
+ */
+static pooled_connection *connectionFind(int sockfd) {
+    auto it = connectionLookup(sockfd);
+    return it == pool.end() ? NULL : &*it;
+}
+
+/**
+ * Adds a freshly opened socket to the pool.
+ *
+ * @param sockfd The socket file descriptor.
+ * @param host   The server it is connected to.
+ * @param portno The server port.
+ */
+static void connectionTrack(int sockfd, const std::string &host, int portno) {
+    pool.emplace_back();
+    pooled_connection &entry = pool.back();
+    entry.sockfd = sockfd;
+    entry.host = host;
+    entry.portno = portno;
+    entry.idle = false;
+    entry.reused = false;
+    entry.reusable = true;
+    entry.rx = buffer_init();
+    entry.rx_end = 0;
+    entry.rx_body = 0;
+    entry.streaming = false;
+}
+
+/**
+ * Closes a pooled socket and forgets it, along with its receive buffer.
+ *
+ * @param it Iterator to the entry.
+ * @return Iterator to the next entry.
+ */
+static std::list<pooled_connection>::iterator connectionDrop(std::list<pooled_connection>::iterator it) {
+    closeConnection(it->sockfd);
+    buffer_free(&it->rx);
+    return pool.erase(it);
+}
+
 /**
- * Appends an HTTP header line to the message.
+ * Checks whether an idle socket is still usable, without blocking.
+ * A closed socket reads EOF, while a healthy idle one has nothing to read.
+ * Unsolicited bytes also disqualify it, since they would corrupt the next reply.
  *
- * @param message The message buffer.
- * @param line    The line to append.
+ * @param sockfd The socket file descriptor.
+ * @return true if the socket can carry a new request.
  */
-void httpMessage(char *message, const char *line) {
-    strcat(message, line);
-    strcat(message, "\r\n");
+static bool connectionAlive(int sockfd) {
+    char peek;
+    ssize_t bytes = recv(sockfd, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    return bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * Writes a whole buffer to a file, retrying short writes and writes
+ * interrupted by a signal before anything was written.
+ *
+ * @param fd   The file descriptor.
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ * @return false if a write failed.
+ */
+bool writeAll(int fd, const void *data, size_t size) {
+    const char *p = (const char *)data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
 }
 
 /**
@@ -51,24 +158,27 @@ std::string httpMessageTrim(const std::string &str) {
  */
 int openConnection(char *host_ip, int portno, int ip_type, int socket_type, int flag) {
     struct sockaddr_in serv_addr;
-    struct hostent *server;
+    struct addrinfo hints, *server;
 
-    // Resolve hostname to IP if needed
-    server = gethostbyname(host_ip);
-    if (server == NULL) {
+    // Resolve hostname to IP if needed (getaddrinfo, unlike gethostbyname,
+    // may be called from the background revalidation thread)
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = ip_type;
+    hints.ai_socktype = socket_type;
+    if (getaddrinfo(host_ip, NULL, &hints, &server) != 0) {
         error("ERROR: No such host found");
     }
 
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    memcpy(&serv_addr, server->ai_addr, sizeof(serv_addr));
+    serv_addr.sin_port = htons(portno);
+    freeaddrinfo(server);
+
     int sockfd = socket(ip_type, socket_type, flag);
     if (sockfd < 0) {
         error("ERROR: Failed to open socket");
     }
 
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = ip_type;
-    serv_addr.sin_port = htons(portno);
-    memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-
     // Connect the socket
     if (connect(sockfd, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) < 0) {
         close(sockfd);
@@ -87,6 +197,93 @@ void closeConnection(int sockfd) {
     close(sockfd);
 }
 
+/**
+ * Returns a connection to a server, preferring an idle pooled one.
+ * Idle sockets are validated before reuse and silently replaced when dead.
+ *
+ * @param host_ip The hostname or IP address of the server.
+ * @param portno  The port number.
+ * @return The socket file descriptor.
+ */
+int connectionAcquire(const char *host_ip, int portno) {
+    for (auto it = pool.begin(); it != pool.end();) {
+        if (!it->idle || it->portno != portno || it->host != host_ip) {
+            ++it;
+            continue;
+        }
+
+        if (connectionAlive(it->sockfd)) {
+            it->idle = false;
+            it->reused = true;
+            return it->sockfd;
+        }
+
+        // The server dropped it while idle
+        it = connectionDrop(it);
+    }
+
+    int sockfd = openConnection((char *)host_ip, portno, AF_INET, SOCK_STREAM, 0);
+    connectionTrack(sockfd, host_ip, portno);
+    return sockfd;
+}
+
+/**
+ * Parks a connection in the pool for the next command.
+ * Connections that cannot be reused, or that exceed POOL_SIZE, are closed.
+ *
+ * @param sockfd The socket file descriptor.
+ */
+void connectionRelease(int sockfd) {
+    auto entry = connectionLookup(sockfd);
+    if (entry == pool.end()) {
+        closeConnection(sockfd);
+        return;
+    }
+
+    size_t idle = 0;
+    for (const auto &other : pool) {
+        idle += other.idle;
+    }
+
+    // A body left half-read would be taken for the next response
+    if (!entry->reusable || entry->streaming || idle >= POOL_SIZE) {
+        connectionDrop(entry);
+        return;
+    }
+
+    entry->idle = true;
+}
+
+/**
+ * Closes every pooled connection.
+ */
+void connectionPoolClear(void) {
+    for (auto it = pool.begin(); it != pool.end();) {
+        it = connectionDrop(it);
+    }
+}
+
+/**
+ * Replaces a pooled connection with a freshly opened one to the same server.
+ *
+ * @param sockfd The socket file descriptor to replace.
+ * @return The new socket file descriptor.
+ */
+static int connectionRenew(int sockfd) {
+    auto entry = connectionLookup(sockfd);
+    if (entry == pool.end()) {
+        error("ERROR: Cannot reconnect an unpooled socket");
+    }
+
+    std::string host = entry->host;
+    int portno = entry->portno;
+    connectionDrop(entry);
+
+    int renewed = openConnection((char *)host.c_str(), portno, AF_INET, SOCK_STREAM, 0);
+    connectionTrack(renewed, host, portno);
+    return renewed;
+}
+
 /**
  * Sends a message to a server via a socket.
  *
@@ -98,7 +295,8 @@ void closeConnection(int sockfd) {
     int total = message.length();
 
     do {
-        bytes = write(sockfd, (const void*)(message.c_str() + sent), total - sent);
+        // MSG_NOSIGNAL: a peer-closed keep-alive socket must fail, not raise SIGPIPE
+        bytes = send(sockfd, (const void*)(message.c_str() + sent), total - sent, MSG_NOSIGNAL);
         if (bytes < 0) {
             error("ERROR: Failed to write message to socket");
         }
@@ -112,60 +310,377 @@ void closeConnection(int sockfd) {
 }
 
 /**
- * Receives a message from a server via a socket.
+ * Prepares a receive buffer for the next response: bytes left over after
+ * the previous response (rx_end onward) are moved to the front and parsed
+ * first.
+ *
+ * @param rx     The receive buffer of the connection.
+ * @param rx_end Offset where the previous response ended, reset to 0.
+ * @param parser Reset, keeping the request method it was set for, then
+ *               fed with the leftover bytes.
+ */
+static void recvBegin(buffer *rx, size_t *rx_end, http_parser *parser) {
+    size_t leftover = rx->size - *rx_end;
+    if (leftover > 0 && *rx_end > 0) {
+        memmove(rx->data, rx->data + *rx_end, leftover);
+    } else if (leftover == 0 && rx->capacity > RECV_RETAIN) {
+        // Do not keep the memory of an unusually large response around
+        buffer_free(rx);
+    }
+    rx->size = leftover;
+    *rx_end = 0;
+
+    *parser = parser_init(parser->head_request);
+    if (rx->size > 0) {
+        parser_feed(parser, rx->data, rx->size);
+    }
+}
+
+/**
+ * Reads once from the socket straight into the buffer's free space and
+ * feeds the new bytes to the parser.
  *
  * @param sockfd The socket file descriptor.
- * @return The received message as a string.
+ * @param rx     The receive buffer of the connection.
+ * @param rx_end Set to the end of the received bytes if the read fails.
+ * @param parser The parser of the response.
+ * @param wanted Capacity the buffer should have before reading.
+ * @return false if the server closed the connection.
  */
- std::string recvServerMessage(int sockfd) {
-    char response[BUFFLEN];
-    buffer buffer = buffer_init();
-    int header_end = 0;
-    int content_length = 0;
+static bool recvMore(int sockfd, buffer *rx, size_t *rx_end, http_parser *parser, size_t wanted) {
+    if (wanted > rx->capacity) {
+        buffer_reserve(rx, wanted > 2 * rx->capacity ? wanted : 2 * rx->capacity);
+    }
 
-    do {
-        int bytes = read(sockfd, response, BUFFLEN);
-        if (bytes < 0) {
-            error("ERROR: Failed to read response from socket");
+    ssize_t bytes = read(sockfd, rx->data + rx->size, rx->capacity - rx->size);
+    if (bytes < 0) {
+        *rx_end = rx->size;
+        error("ERROR: Failed to read response from socket");
+    }
+
+    if (bytes == 0) {
+        // Ends a close-delimited body, truncates any other
+        parser_finish(parser);
+        return false;
+    }
+
+    rx->size += (size_t)bytes;
+    parser_feed(parser, rx->data, rx->size);
+    return true;
+}
+
+/**
+ * Receives one response into a receive buffer, reading straight from the
+ * socket into the buffer's free space. Bytes past the end of this
+ * response stay in place for the next one.
+ *
+ * @param sockfd The socket file descriptor.
+ * @param rx     The receive buffer of the connection.
+ * @param rx_end Offset where the previous response ended, updated for this one.
+ * @param parser Filled with the parsed status line and headers.
+ * @return A view of the decoded response inside `rx`.
+ */
+static std::string_view recvIntoBuffer(int sockfd, buffer *rx, size_t *rx_end, http_parser *parser) {
+    recvBegin(rx, rx_end, parser);
+
+    while (parser->state != PARSER_DONE && parser->state != PARSER_ERROR) {
+        // A fresh buffer reads into its inline storage first, so tiny replies
+        // (304s, errors) never touch the heap. Past that, a known length sizes
+        // the buffer once, otherwise it grows geometrically. The length comes
+        // from the server, so only so much is trusted up front
+        size_t wanted = rx->capacity == 0 ? BUFFER_INLINE : rx->size + BUFFLEN;
+        if (parser->state == PARSER_BODY && parser->content_length > 0) {
+            size_t total = parser->header_end + (size_t)parser->content_length;
+            if (total > RECV_PRESIZE_MAX) total = RECV_PRESIZE_MAX;
+            if (total > wanted) wanted = total;
         }
 
-        if (bytes == 0) {
+        if (!recvMore(sockfd, rx, rx_end, parser, wanted)) {
             break;
         }
+    }
+
+    if (parser->state != PARSER_DONE) {
+        *rx_end = rx->size;
+        return std::string_view(rx->data, rx->size);
+    }
 
-        buffer_add(&buffer, response, (size_t) bytes);
-        header_end = buffer_find(&buffer, HEADER_TERMINATOR, HEADER_TERMINATOR_SIZE);
+    // A chunked body has been decoded in place, the framing is dropped here
+    *rx_end = parser->pos;
+    return std::string_view(rx->data, parser_message_size(parser));
+}
 
-        if (header_end >= 0) {
-            header_end += HEADER_TERMINATOR_SIZE;
-            int content_length_start = buffer_find_insensitive(&buffer, CONTENT_LENGTH, CONTENT_LENGTH_SIZE);
+/**
+ * Receives a message from a pooled connection without copying it.
+ * The response is parsed incrementally as it arrives, so the status line
+ * and headers are scanned once and the body framing (Content-Length,
+ * chunked or close-delimited) is known as soon as the headers end.
+ *
+ * @param sockfd The socket file descriptor, as returned by connectionAcquire().
+ * @param parser Filled with the parsed status line and headers.
+ * @return A view of the message, valid until the next receive on (or release of) sockfd.
+ */
+std::string_view recvServerView(int sockfd, http_parser *parser) {
+    pooled_connection *entry = connectionFind(sockfd);
+    if (entry == NULL) {
+        error("ERROR: Cannot receive on an unpooled socket");
+    }
 
-            if (content_length_start < 0) {
-                continue;           
-            }
+    std::string_view message = recvIntoBuffer(sockfd, &entry->rx, &entry->rx_end, parser);
 
-            content_length_start += CONTENT_LENGTH_SIZE;
-            content_length = strtol(buffer.data + content_length_start, NULL, 10);
+    // Only a complete response on a keep-alive connection leaves it reusable
+    if (parser->state != PARSER_DONE || !parser->keep_alive) {
+        entry->reusable = false;
+    }
+
+    return message;
+}
+
+/**
+ * Receives only the status line and headers of a message from a pooled
+ * connection. The body is then read piece by piece with recvServerBody(),
+ * and must be read to the end for the connection to be reused.
+ *
+ * @param sockfd The socket file descriptor, as returned by connectionAcquire().
+ * @param parser Filled with the parsed status line and headers.
+ * @return A view of the headers and of the body bytes received with them,
+ *         valid until the first recvServerBody() call.
+ */
+std::string_view recvServerHead(int sockfd, http_parser *parser) {
+    pooled_connection *entry = connectionFind(sockfd);
+    if (entry == NULL) {
+        error("ERROR: Cannot receive on an unpooled socket");
+    }
+
+    buffer *rx = &entry->rx;
+    recvBegin(rx, &entry->rx_end, parser);
+
+    while (parser->state == PARSER_STATUS_LINE || parser->state == PARSER_HEADERS) {
+        if (!recvMore(sockfd, rx, &entry->rx_end, parser, rx->size + BUFFLEN)) {
             break;
         }
-    } while (1);
+    }
 
-    size_t total = content_length + (size_t) header_end;
-    
-    while (buffer.size < total) {
-        int bytes = read(sockfd, response, BUFFLEN);
-        if (bytes < 0) {
-            error("ERROR: Failed to read response from socket");
-        }
+    entry->rx_body = 0;
+    entry->streaming = parser->state == PARSER_BODY;
+    entry->rx_end = parser->state == PARSER_DONE ? parser->pos : rx->size;
 
-        if (bytes == 0) {
+    if (parser->state == PARSER_ERROR || (parser->state == PARSER_DONE && !parser->keep_alive)) {
+        entry->reusable = false;
+    }
+
+    if (parser->state == PARSER_STATUS_LINE || parser->state == PARSER_HEADERS || parser->state == PARSER_ERROR) {
+        return std::string_view(rx->data, rx->size);
+    }
+    return std::string_view(rx->data, parser_message_size(parser));
+}
+
+/**
+ * Returns the next piece of a body whose headers were received by
+ * recvServerHead(). The piece handed out by the previous call is dropped
+ * first, so the receive buffer stays the same size however long the body.
+ *
+ * @param sockfd The socket file descriptor.
+ * @param parser The parser filled by recvServerHead().
+ * @return The next decoded body bytes, empty once the body is over.
+ *         Valid until the next call.
+ */
+std::string_view recvServerBody(int sockfd, http_parser *parser) {
+    pooled_connection *entry = connectionFind(sockfd);
+    if (entry == NULL) {
+        error("ERROR: Cannot receive on an unpooled socket");
+    }
+
+    buffer *rx = &entry->rx;
+    if (entry->rx_body > 0) {
+        rx->size = parser_discard_body(parser, rx->data, rx->size);
+        entry->rx_body = 0;
+    }
+
+    while (parser->state == PARSER_BODY && parser->body_size == 0) {
+        if (!recvMore(sockfd, rx, &entry->rx_end, parser, rx->size + BUFFLEN)) {
             break;
         }
+    }
+
+    if (parser->state != PARSER_BODY) {
+        entry->streaming = false;
+        entry->rx_end = parser->state == PARSER_DONE ? parser->pos : rx->size;
 
-        buffer_add(&buffer, response, (size_t) bytes);
+        // Only a complete response on a keep-alive connection leaves it reusable
+        if (parser->state != PARSER_DONE || !parser->keep_alive) {
+            entry->reusable = false;
+        }
     }
 
-    std::string result = buffer.data;
-    buffer_free(&buffer);
+    if (parser->state != PARSER_BODY && parser->state != PARSER_DONE) {
+        return std::string_view();
+    }
+
+    entry->rx_body = parser->body_size;
+    return std::string_view(rx->data + parser->header_end, parser->body_size);
+}
+
+/**
+ * Receives a message from a server via a socket.
+ *
+ * @param sockfd The socket file descriptor.
+ * @param parser Set up by parser_init() for the request, then filled with the
+ *               parsed status line and headers.
+ * @return The received message as a string.
+ */
+std::string recvServerMessage(int sockfd, http_parser *parser) {
+    if (connectionFind(sockfd) != NULL) {
+        return std::string(recvServerView(sockfd, parser));
+    }
+
+    buffer rx = buffer_init();
+    size_t rx_end = 0;
+    std::string result;
+
+    try {
+        result = std::string(recvIntoBuffer(sockfd, &rx, &rx_end, parser));
+    } catch (const std::runtime_error &e) {
+        buffer_free(&rx);
+        throw;
+    }
+
+    buffer_free(&rx);
     return result;
 }
+
+/**
+ * Receives a message from a server via a socket.
+ *
+ * @param sockfd The socket file descriptor.
+ * @return The received message as a string.
+ */
+std::string recvServerMessage(int sockfd) {
+    http_parser parser = parser_init();
+    return recvServerMessage(sockfd, &parser);
+}
+
+/**
+ * Checks whether a request is a HEAD, whose reply never has a body.
+ *
+ * @param message The request.
+ * @return true for a HEAD request.
+ */
+static bool requestIsHead(const std::string &message) {
+    return message.compare(0, 5, "HEAD ") == 0;
+}
+
+/**
+ * Sends a message over a private connection and receives the whole
+ * reply. The connection is opened for this exchange alone and never
+ * pooled, so this may run on another thread than the commands.
+ *
+ * @param host_ip The hostname or IP address of the server.
+ * @param portno  The port number.
+ * @param message The message to send.
+ * @param parser  Filled with the parsed reply.
+ * @return The reply.
+ */
+std::string fetchServerMessage(const char *host_ip, int portno, const std::string &message, http_parser *parser) {
+    int sockfd = openConnection((char *)host_ip, portno, AF_INET, SOCK_STREAM, 0);
+    buffer rx = buffer_init();
+    size_t rx_end = 0;
+    std::string result;
+
+    *parser = parser_init(requestIsHead(message));
+    try {
+        sendServerMessage(sockfd, message);
+        result = std::string(recvIntoBuffer(sockfd, &rx, &rx_end, parser));
+    } catch (const std::runtime_error &e) {
+        buffer_free(&rx);
+        closeConnection(sockfd);
+        throw;
+    }
+
+    buffer_free(&rx);
+    closeConnection(sockfd);
+    return result;
+}
+
+
+typedef std::string_view (*recv_fn)(int sockfd, http_parser *parser);
+
+/**
+ * Checks whether a request may be sent twice without harm. Only reads
+ * qualify: a POST or DELETE the server acted on before the connection
+ * failed would otherwise be acted on again.
+ *
+ * @param message The request.
+ * @return true for a GET or HEAD request.
+ */
+static bool requestReplayable(const std::string &message) {
+    return message.compare(0, 4, "GET ") == 0 || requestIsHead(message);
+}
+
+/**
+ * Sends a message and receives the reply over a pooled connection.
+ * If a reused keep-alive connection turns out to have been closed by the
+ * server before answering (the send failed, or not a byte of the reply
+ * came back), a GET or HEAD request is replayed once on a fresh
+ * connection. Anything else, or a reply cut short, is left to the caller.
+ *
+ * @param sockfd  The socket file descriptor, updated if it had to be replaced.
+ * @param message The message to send.
+ * @param parser  Filled with the parsed reply.
+ * @param receive Receives the reply (or its head) on the connection.
+ * @return A view of the reply, as returned by `receive`.
+ */
+static std::string_view exchangeWith(int &sockfd, const std::string &message, http_parser *parser, recv_fn receive) {
+    pooled_connection *entry = connectionFind(sockfd);
+    bool replay = entry != NULL && entry->reused && requestReplayable(message);
+    bool sent = false;
+    std::string_view response;
+
+    *parser = parser_init(requestIsHead(message));
+    try {
+        sendServerMessage(sockfd, message);
+        sent = true;
+        response = receive(sockfd, parser);
+    } catch (const std::runtime_error &e) {
+        // The receive buffer holds what came back of this reply
+        if (!replay || (sent && entry->rx.size > 0)) throw;
+    }
+
+    if (response.empty() && replay) {
+        sockfd = connectionRenew(sockfd);
+        sendServerMessage(sockfd, message);
+        response = receive(sockfd, parser);
+    }
+
+    return response;
+}
+
+/**
+ * Sends a message and receives the whole reply over a pooled connection.
+ *
+ * @param sockfd  The socket file descriptor, updated if it had to be replaced.
+ * @param message The message to send.
+ * @param parser  Filled with the parsed reply (optional).
+ * @return A view of the reply, valid until the next receive on (or release of) sockfd.
+ */
+std::string_view exchangeServerMessage(int &sockfd, const std::string &message, http_parser *parser) {
+    http_parser local;
+    if (parser == NULL) {
+        parser = &local;
+    }
+
+    return exchangeWith(sockfd, message, parser, recvServerView);
+}
+
+/**
+ * Sends a message and receives the status line and headers of the reply
+ * over a pooled connection; the body is left to recvServerBody().
+ *
+ * @param sockfd  The socket file descriptor, updated if it had to be replaced.
+ * @param message The message to send.
+ * @param parser  Filled with the parsed status line and headers.
+ * @return A view of the head, valid until the first recvServerBody() call.
+ */
+std::string_view exchangeServerHead(int &sockfd, const std::string &message, http_parser *parser) {
+    return exchangeWith(sockfd, message, parser, recvServerHead);
+}
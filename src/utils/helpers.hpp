@@ -2,15 +2,24 @@
 #define HELPERS_HPP
 
 #include <string>
+#include <string_view>
+
+#include "parser.hpp"
 
 #define BUFFLEN 4096
-#define LINELEN 1000
 
-#define HEADER_TERMINATOR "\r\n\r\n"
-#define HEADER_TERMINATOR_SIZE (sizeof(HEADER_TERMINATOR) - 1)
+// Maximum number of idle keep-alive connections kept open
+#define POOL_SIZE 4
+
+// Receive buffers larger than this are released between responses
+#define RECV_RETAIN (1 << 20)
+
+// Most a Content-Length may reserve before its bytes arrive; a longer
+// body grows the buffer geometrically as it is received
+#define RECV_PRESIZE_MAX (4 << 20)
 
-#define CONTENT_LENGTH "Content-Length: "
-#define CONTENT_LENGTH_SIZE (sizeof(CONTENT_LENGTH) - 1)
+// Writes size bytes of data to file fd, retrying short and interrupted writes
+bool writeAll(int fd, const void *data, size_t size);
 
 // Opens a connection with server host_ip on port portno, returns a socket
 int openConnection(char *host_ip, int portno, int ip_type, int socket_type, int flag);
@@ -18,8 +27,14 @@ int openConnection(char *host_ip, int portno, int ip_type, int socket_type, int
 // Closes a server connection on socket sockfd
 void closeConnection(int sockfd);
 
-// Adds a line to a string message
-void httpMessage(char *message, const char *line);
+// Returns a live connection to host_ip on port portno, reusing an idle pooled one if possible
+int connectionAcquire(const char *host_ip, int portno);
+
+// Hands a connection back to the pool, or closes it if it cannot be reused
+void connectionRelease(int sockfd);
+
+// Closes every pooled connection
+void connectionPoolClear(void);
 
 // Trims the whitespace from a string
 std::string httpMessageTrim(const std::string &str);
@@ -30,4 +45,26 @@ void sendServerMessage(int sockfd, const std::string &message);
 // Receives and returns the message from a server
 std::string recvServerMessage(int sockfd);
 
+// Receives the message from a server and exposes its parsed status line and headers.
+// parser must come from parser_init(), which tells whether the request was a HEAD.
+std::string recvServerMessage(int sockfd, http_parser *parser);
+
+// Receives the message from a pooled connection as a view into its receive buffer
+std::string_view recvServerView(int sockfd, http_parser *parser);
+
+// Receives only the status line and headers from a pooled connection, the body is left to recvServerBody()
+std::string_view recvServerHead(int sockfd, http_parser *parser);
+
+// Returns the next decoded piece of a body after recvServerHead(), empty once the body is over
+std::string_view recvServerBody(int sockfd, http_parser *parser);
+
+// Sends a message over a private, unpooled connection and returns the reply; safe from any thread
+std::string fetchServerMessage(const char *host_ip, int portno, const std::string &message, http_parser *parser);
+
+// Sends a message and returns a view of the reply, reconnecting once if a reused connection was dropped
+std::string_view exchangeServerMessage(int &sockfd, const std::string &message, http_parser *parser = NULL);
+
+// Sends a message and returns a view of the reply's head, the body is then read with recvServerBody()
+std::string_view exchangeServerHead(int &sockfd, const std::string &message, http_parser *parser);
+
 #endif // HELPERS_HPP
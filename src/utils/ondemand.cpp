@@ -0,0 +1,562 @@
+#include <string.h>
+
+#include "ondemand.hpp"
+
+// Read position over the text being validated
+typedef struct {
+    const char *pos;
+    const char *end;
+} cursor;
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static inline void skip_space(cursor *c) {
+    while (c->pos < c->end && is_space(*c->pos)) ++c->pos;
+}
+
+/**
+ * Tells the type of a value from its first byte.
+ * @param c The first byte of a validated value.
+ * @return The type.
+ */
+static json_type type_of(char c) {
+    switch (c) {
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case '"': return JSON_STRING;
+        case 't':
+        case 'f': return JSON_BOOLEAN;
+        case 'n': return JSON_NULL;
+        default: return JSON_NUMBER;
+    }
+}
+
+/**
+ * Reads the 4 hex digits of a \u escape.
+ * @param c The cursor, on the first digit. Left past the last one.
+ * @param unit Set to the UTF-16 code unit.
+ * @return false if the digits are missing or malformed.
+ */
+static bool validate_hex4(cursor *c, unsigned *unit) {
+    if (c->end - c->pos < 4) return false;
+
+    *unit = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hex_value(*c->pos++);
+        if (digit < 0) return false;
+        *unit = *unit << 4 | (unsigned)digit;
+    }
+    return true;
+}
+
+/**
+ * Validates the bytes following the lead byte of a UTF-8 sequence
+ * (RFC 3629): overlong forms, surrogates and code points past U+10FFFF
+ * are rejected, as nlohmann::json rejects them.
+ * @param c The cursor, past the lead byte. Left past the sequence.
+ * @param lead The lead byte, 0x80 or above.
+ * @return false if the sequence is ill-formed.
+ */
+static bool validate_utf8(cursor *c, unsigned char lead) {
+    // Bytes to follow, and the range of the first of them
+    size_t count;
+    unsigned char low = 0x80, high = 0xBF;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        count = 1;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        count = 2;
+        if (lead == 0xE0) low = 0xA0;        // overlong
+        else if (lead == 0xED) high = 0x9F;  // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        count = 3;
+        if (lead == 0xF0) low = 0x90;        // overlong
+        else if (lead == 0xF4) high = 0x8F;  // past U+10FFFF
+    } else {
+        return false;
+    }
+
+    if ((size_t)(c->end - c->pos) < count) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char ch = (unsigned char)c->pos[i];
+        if (ch < low || ch > high) {
+            return false;
+        }
+        low = 0x80;
+        high = 0xBF;
+    }
+
+    c->pos += count;
+    return true;
+}
+
+/**
+ * Validates a string: escapes, surrogate pairs and UTF-8 included, so a
+ * string accepted here is one nlohmann::json accepts too.
+ * @param c The cursor, on the opening quote. Left past the closing quote.
+ * @return false if the string is malformed or unterminated.
+ */
+static bool validate_string(cursor *c) {
+    ++c->pos;
+
+    while (c->pos < c->end) {
+        unsigned char ch = (unsigned char)*c->pos++;
+        if (ch == '"') {
+            return true;
+        }
+        if (ch < 0x20) {
+            return false;
+        }
+        if (ch >= 0x80) {
+            if (!validate_utf8(c, ch)) return false;
+            continue;
+        }
+        if (ch != '\\') {
+            continue;
+        }
+
+        if (c->pos >= c->end) {
+            return false;
+        }
+        unsigned unit;
+        switch (*c->pos++) {
+            case '"': case '\\': case '/':
+            case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                if (!validate_hex4(c, &unit)) return false;
+
+                // A high surrogate must be followed by a low one, which never stands alone
+                if (unit >= 0xDC00 && unit <= 0xDFFF) return false;
+                if (unit >= 0xD800 && unit <= 0xDBFF) {
+                    if (c->end - c->pos < 2 || c->pos[0] != '\\' || c->pos[1] != 'u') return false;
+                    c->pos += 2;
+                    if (!validate_hex4(c, &unit) || unit < 0xDC00 || unit > 0xDFFF) return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Validates a number: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ * @param c The cursor, on the first byte. Left past the number.
+ * @return false if the number is malformed.
+ */
+static bool validate_number(cursor *c) {
+    if (c->pos < c->end && *c->pos == '-') ++c->pos;
+    if (c->pos >= c->end || !is_digit(*c->pos)) return false;
+
+    if (*c->pos++ != '0') {
+        while (c->pos < c->end && is_digit(*c->pos)) ++c->pos;
+    }
+
+    if (c->pos < c->end && *c->pos == '.') {
+        ++c->pos;
+        if (c->pos >= c->end || !is_digit(*c->pos)) return false;
+        while (c->pos < c->end && is_digit(*c->pos)) ++c->pos;
+    }
+
+    if (c->pos < c->end && (*c->pos == 'e' || *c->pos == 'E')) {
+        ++c->pos;
+        if (c->pos < c->end && (*c->pos == '+' || *c->pos == '-')) ++c->pos;
+        if (c->pos >= c->end || !is_digit(*c->pos)) return false;
+        while (c->pos < c->end && is_digit(*c->pos)) ++c->pos;
+    }
+
+    return true;
+}
+
+/**
+ * Validates a literal (true, false or null).
+ * @param c The cursor, on the first byte. Left past the literal.
+ * @param literal The expected literal.
+ * @return false if the bytes do not match.
+ */
+static bool validate_literal(cursor *c, const char *literal) {
+    size_t size = strlen(literal);
+    if ((size_t)(c->end - c->pos) < size || memcmp(c->pos, literal, size) != 0) {
+        return false;
+    }
+    c->pos += size;
+    return true;
+}
+
+/**
+ * Validates one value and everything nested in it.
+ * @param c The cursor, before the value (whitespace allowed). Left past it.
+ * @param depth The nesting of the value.
+ * @return false if the value is malformed or nested too deep.
+ */
+static bool validate_value(cursor *c, int depth) {
+    skip_space(c);
+    if (c->pos >= c->end) {
+        return false;
+    }
+
+    switch (*c->pos) {
+        case '"':
+            return validate_string(c);
+        case 't':
+            return validate_literal(c, "true");
+        case 'f':
+            return validate_literal(c, "false");
+        case 'n':
+            return validate_literal(c, "null");
+        case '{':
+        case '[':
+            break;
+        default:
+            return validate_number(c);
+    }
+
+    bool object = *c->pos == '{';
+    char close = object ? '}' : ']';
+    if (depth >= JSON_MAX_DEPTH) {
+        return false;
+    }
+
+    ++c->pos;
+    skip_space(c);
+    if (c->pos < c->end && *c->pos == close) {
+        ++c->pos;
+        return true;
+    }
+
+    while (true) {
+        if (object) {
+            skip_space(c);
+            if (c->pos >= c->end || *c->pos != '"' || !validate_string(c)) {
+                return false;
+            }
+            skip_space(c);
+            if (c->pos >= c->end || *c->pos != ':') {
+                return false;
+            }
+            ++c->pos;
+        }
+
+        if (!validate_value(c, depth + 1)) {
+            return false;
+        }
+
+        skip_space(c);
+        if (c->pos >= c->end) {
+            return false;
+        }
+        if (*c->pos == ',') {
+            ++c->pos;
+            continue;
+        }
+        if (*c->pos == close) {
+            ++c->pos;
+            return true;
+        }
+        return false;
+    }
+}
+
+/**
+ * Validates text as exactly one JSON value surrounded by optional
+ * whitespace. Nothing is decoded or allocated: the document stays in
+ * place and values are read from it on demand. Strings are checked for
+ * well-formed escapes and UTF-8, as strictly as nlohmann::json does.
+ * @param text The document.
+ * @return The root value, or a JSON_NONE value if the text is malformed.
+ */
+json_value json_validate(std::string_view text) {
+    json_value root = {JSON_NONE, NULL, 0};
+    cursor c = {text.data(), text.data() + text.size()};
+
+    skip_space(&c);
+    const char *start = c.pos;
+    if (!validate_value(&c, 0)) {
+        return root;
+    }
+
+    const char *stop = c.pos;
+    skip_space(&c);
+    if (c.pos != c.end) {
+        return root;
+    }
+
+    root.type = type_of(*start);
+    root.data = start;
+    root.size = stop - start;
+    return root;
+}
+
+/**
+ * Skips a string of a validated document.
+ * @param p The opening quote.
+ * @param end The end of the enclosing container.
+ * @return Past the closing quote.
+ */
+static const char *skip_string(const char *p, const char *end) {
+    ++p;
+    while (true) {
+        const char *quote = (const char *)memchr(p, '"', end - p);
+
+        // The quote is escaped if an odd number of backslashes precede it
+        size_t backslashes = 0;
+        while (quote - backslashes > p && quote[-1 - (long)backslashes] == '\\') ++backslashes;
+        if (backslashes % 2 == 0) {
+            return quote + 1;
+        }
+        p = quote + 1;
+    }
+}
+
+/**
+ * Skips a value of a validated document without looking inside it.
+ * @param p The first byte of the value.
+ * @param end The end of the enclosing container.
+ * @return Past the value.
+ */
+static const char *skip_value(const char *p, const char *end) {
+    if (*p == '"') {
+        return skip_string(p, end);
+    }
+
+    if (*p != '{' && *p != '[') {
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && !is_space(*p)) ++p;
+        return p;
+    }
+
+    int depth = 0;
+    do {
+        char ch = *p;
+        if (ch == '"') {
+            p = skip_string(p, end);
+            continue;
+        }
+        if (ch == '{' || ch == '[') ++depth;
+        else if (ch == '}' || ch == ']') --depth;
+        ++p;
+    } while (depth > 0);
+
+    return p;
+}
+
+/**
+ * Starts iterating a container. Iterating any other value yields nothing.
+ * @param container An array or object of a validated document.
+ * @return The iterator.
+ */
+json_iter json_iter_init(json_value container) {
+    json_iter iter;
+    iter.object = container.type == JSON_OBJECT;
+    iter.end = container.data + container.size;
+    iter.pos = (container.type == JSON_ARRAY || iter.object) ? container.data + 1 : iter.end;
+    return iter;
+}
+
+/**
+ * Moves to the next element of a container, skipping over the previous
+ * one without decoding it.
+ * @param iter The iterator.
+ * @param key Set to the raw key of an object member (may be NULL).
+ * @param value Set to the element.
+ * @return false once the container is exhausted.
+ */
+bool json_iter_next(json_iter *iter, std::string_view *key, json_value *value) {
+    const char *p = iter->pos;
+    while (p < iter->end && (is_space(*p) || *p == ',')) ++p;
+
+    if (p >= iter->end || *p == '}' || *p == ']') {
+        iter->pos = iter->end;
+        return false;
+    }
+
+    if (iter->object) {
+        const char *stop = skip_string(p, iter->end);
+        if (key != NULL) {
+            *key = std::string_view(p + 1, stop - p - 2);
+        }
+
+        // Skip the colon and the whitespace around it
+        p = stop;
+        while (is_space(*p) || *p == ':') ++p;
+    }
+
+    value->type = type_of(*p);
+    value->data = p;
+    p = skip_value(p, iter->end);
+    value->size = p - value->data;
+
+    iter->pos = p;
+    return true;
+}
+
+/**
+ * Appends a code point to a string as UTF-8.
+ * @param out The string.
+ * @param cp The code point.
+ */
+static void append_utf8(std::string *out, unsigned long cp) {
+    if (cp < 0x80) {
+        out->push_back((char)cp);
+    } else if (cp < 0x800) {
+        out->push_back((char)(0xC0 | (cp >> 6)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out->push_back((char)(0xE0 | (cp >> 12)));
+        out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out->push_back((char)(0xF0 | (cp >> 18)));
+        out->push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/**
+ * Reads the 4 hex digits of a validated \u escape.
+ * @param p The first digit.
+ * @return The code unit.
+ */
+static unsigned long read_hex4(const char *p) {
+    unsigned long unit = 0;
+    for (int i = 0; i < 4; ++i) {
+        unit = (unit << 4) | (unsigned long)hex_value(p[i]);
+    }
+    return unit;
+}
+
+/**
+ * Decodes the escapes of a validated string body.
+ * @param p The first byte after the opening quote.
+ * @param size The length up to the closing quote.
+ * @param out Replaced with the decoded string.
+ */
+static void unescape(const char *p, size_t size, std::string *out) {
+    const char *end = p + size;
+    out->clear();
+    out->reserve(size);
+
+    while (p < end) {
+        const char *backslash = (const char *)memchr(p, '\\', end - p);
+        if (backslash == NULL) {
+            out->append(p, end - p);
+            return;
+        }
+
+        out->append(p, backslash - p);
+        p = backslash + 1;
+
+        switch (*p++) {
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u': {
+                unsigned long cp = read_hex4(p);
+                p += 4;
+
+                // A high surrogate followed by a low one encodes a single code point,
+                // a lone surrogate becomes U+FFFD
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    unsigned long low = read_hex4(p + 2);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                // '"', '\\' and '/' stand for themselves
+                out->push_back(p[-1]);
+                break;
+        }
+    }
+}
+
+/**
+ * Finds an object member by name. Members before it are skipped without
+ * being decoded, and keys are only unescaped when they contain escapes.
+ * @param object An object of a validated document.
+ * @param key The member name.
+ * @return The member value, or a JSON_NONE value if absent.
+ */
+json_value json_find(json_value object, std::string_view key) {
+    json_value value = {JSON_NONE, NULL, 0};
+    if (object.type != JSON_OBJECT) {
+        return value;
+    }
+
+    json_iter iter = json_iter_init(object);
+    std::string_view raw;
+    std::string decoded;
+
+    while (json_iter_next(&iter, &raw, &value)) {
+        if (raw.find('\\') == std::string_view::npos) {
+            if (raw == key) return value;
+            continue;
+        }
+
+        unescape(raw.data(), raw.size(), &decoded);
+        if (decoded == key) {
+            return value;
+        }
+    }
+
+    value.type = JSON_NONE;
+    value.data = NULL;
+    value.size = 0;
+    return value;
+}
+
+/**
+ * Decodes a string value.
+ * @param value A value of a validated document.
+ * @param out Replaced with the decoded string.
+ * @return false if the value is not a string.
+ */
+bool json_get_string(json_value value, std::string *out) {
+    if (value.type != JSON_STRING) {
+        return false;
+    }
+
+    unescape(value.data + 1, value.size - 2, out);
+    return true;
+}
+
+/**
+ * Returns a scalar as text. Strings are decoded; numbers, booleans and
+ * null are returned as written, containers as their raw JSON.
+ * @param value A value of a validated document.
+ * @return The text, empty for a JSON_NONE value.
+ */
+std::string json_get_text(json_value value) {
+    std::string text;
+    if (!json_get_string(value, &text) && value.type != JSON_NONE) {
+        text.assign(value.data, value.size);
+    }
+    return text;
+}
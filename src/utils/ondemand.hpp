@@ -0,0 +1,56 @@
+#ifndef ONDEMAND_HPP
+#define ONDEMAND_HPP
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+// Deepest nesting of arrays and objects json_validate() accepts
+#define JSON_MAX_DEPTH 256
+
+// Kind of a JSON value, known from its first byte
+typedef enum {
+    JSON_NONE,     // absent (lookup miss) or invalid
+    JSON_NULL,
+    JSON_BOOLEAN,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_type;
+
+// Value inside a validated document: its raw bytes, nothing is decoded
+typedef struct {
+    json_type type;
+    const char *data;  // first byte of the value
+    size_t size;       // length of the value, quotes and brackets included
+} json_value;
+
+// Position inside an array or an object, see json_iter_next()
+typedef struct {
+    const char *pos;   // next byte to read
+    const char *end;   // one past the closing bracket
+    bool object;
+} json_iter;
+
+// Validates text as one JSON value in a single pass and returns its root,
+// JSON_NONE if the text is malformed
+json_value json_validate(std::string_view text);
+
+// Starts iterating the elements of an array or the members of an object
+json_iter json_iter_init(json_value container);
+
+// Moves to the next element; for objects key is set to the raw (still escaped) key.
+// Returns false once the container is exhausted.
+bool json_iter_next(json_iter *iter, std::string_view *key, json_value *value);
+
+// Finds the member of an object named key, JSON_NONE if absent
+json_value json_find(json_value object, std::string_view key);
+
+// Decodes a string value into out, returns false if value is not a string
+bool json_get_string(json_value value, std::string *out);
+
+// Returns a scalar as text: strings decoded, numbers and literals as written
+std::string json_get_text(json_value value);
+
+#endif // ONDEMAND_HPP
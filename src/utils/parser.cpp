@@ -0,0 +1,483 @@
+#include <string.h>
+#include <strings.h>
+
+#include "parser.hpp"
+
+/**
+ * Initializes a parser, ready to read a status line.
+ * @param head_request Whether the reply answers a HEAD request, whose
+ *                     Content-Length describes a body that is never sent.
+ * @return A fresh parser.
+ */
+http_parser parser_init(bool head_request) {
+    http_parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.state = PARSER_STATUS_LINE;
+    parser.head_request = head_request;
+    parser.content_length = -1;
+    parser.keep_alive = true;
+    return parser;
+}
+
+/**
+ * Checks a header name against a known one, ignoring case.
+ * @param data The response bytes.
+ * @param header The parsed header.
+ * @param name The expected name.
+ * @return true if the names match.
+ */
+static bool header_is(const char *data, const http_header *header, const char *name) {
+    return header->name_size == strlen(name) &&
+           strncasecmp(data + header->name, name, header->name_size) == 0;
+}
+
+/**
+ * Parses "HTTP/1.x SP code SP reason".
+ * @param parser The parser.
+ * @param line The start of the line.
+ * @param start The offset of the line in the response.
+ * @param size The line length, without CRLF.
+ * @return false if the line is malformed.
+ */
+static bool parse_status_line(http_parser *parser, const char *line, size_t start, size_t size) {
+    if (size < 12 || strncmp(line, "HTTP/1.", 7) != 0 || line[8] != ' ') {
+        return false;
+    }
+
+    int code = 0;
+    for (size_t i = 9; i < 12; ++i) {
+        if (line[i] < '0' || line[i] > '9') {
+            return false;
+        }
+        code = code * 10 + (line[i] - '0');
+    }
+
+    parser->status_code = code;
+    parser->keep_alive = (line[7] == '1');
+    parser->reason = start + (size > 12 ? 13 : 12);
+    parser->reason_size = size > 12 ? size - 13 : 0;
+    return true;
+}
+
+/**
+ * Parses one "Name: value" line and records the fields the client relies on.
+ * @param parser The parser.
+ * @param data The response bytes.
+ * @param start The offset of the line.
+ * @param size The line length, without CRLF.
+ * @return false if the line is malformed.
+ */
+static bool parse_header_line(http_parser *parser, const char *data, size_t start, size_t size) {
+    const char *line = data + start;
+    const char *colon = (const char *)memchr(line, ':', size);
+    if (colon == NULL || colon == line) {
+        return false;
+    }
+
+    http_header header;
+    header.name = start;
+    header.name_size = colon - line;
+
+    // Trim optional whitespace around the value
+    size_t value = header.name_size + 1;
+    size_t end = size;
+    while (value < end && (line[value] == ' ' || line[value] == '\t')) ++value;
+    while (end > value && (line[end - 1] == ' ' || line[end - 1] == '\t')) --end;
+    header.value = start + value;
+    header.value_size = end - value;
+
+    if (header_is(data, &header, "Content-Length")) {
+        if (header.value_size == 0) {
+            return false;
+        }
+
+        // Checked digit by digit, so an oversized value cannot overflow
+        long length = 0;
+        for (size_t i = 0; i < header.value_size; ++i) {
+            char c = data[header.value + i];
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            length = length * 10 + (c - '0');
+            if (length > HTTP_MAX_CONTENT_LENGTH) {
+                return false;
+            }
+        }
+
+        // A repeated header must agree, or the body length is ambiguous
+        if (parser->content_length >= 0 && parser->content_length != length) {
+            return false;
+        }
+        parser->content_length = length;
+    } else if (header_is(data, &header, "Transfer-Encoding")) {
+        // Only a final "chunked" coding frames the body
+        parser->transfer_encoded = true;
+        parser->chunked = header.value_size >= 7 &&
+            strncasecmp(data + header.value + header.value_size - 7, "chunked", 7) == 0;
+    } else if (header_is(data, &header, "Connection")) {
+        if (header.value_size == 5 && strncasecmp(data + header.value, "close", 5) == 0) {
+            parser->keep_alive = false;
+        } else if (header.value_size == 10 && strncasecmp(data + header.value, "keep-alive", 10) == 0) {
+            parser->keep_alive = true;
+        }
+    }
+
+    // A header left out of the index would silently read as absent
+    if (parser->headers_count == HTTP_MAX_HEADERS) {
+        return false;
+    }
+    parser->headers[parser->headers_count++] = header;
+    return true;
+}
+
+/**
+ * Picks how the body is framed once all headers are known (RFC 9112, 6.3).
+ * @param parser The parser.
+ * @return false if both Content-Length and Transfer-Encoding frame it.
+ */
+static bool parse_body_framing(http_parser *parser) {
+    int code = parser->status_code;
+
+    // Two framings are how responses get smuggled, neither is trusted
+    if (parser->transfer_encoded && parser->content_length >= 0) {
+        return false;
+    }
+
+    if ((code >= 100 && code < 200) || code == 204 || code == 304 || parser->head_request) {
+        // Never a body, whatever the headers announce
+        parser->chunked = false;
+        parser->content_length = 0;
+    } else if (parser->chunked) {
+        parser->chunk = CHUNK_SIZE;
+    } else if (parser->content_length < 0) {
+        parser->close_delimited = true;
+        parser->keep_alive = false;
+    }
+    return true;
+}
+
+/**
+ * Drops an interim 1xx head (100 Continue, 103 Early Hints, ...) so the
+ * final response is parsed after it. Its bytes stay in place; `start`
+ * marks where the final status line begins.
+ * @param parser The parser, positioned right after the interim head.
+ */
+static void skip_interim_head(http_parser *parser) {
+    bool head_request = parser->head_request;
+    size_t pos = parser->pos;
+
+    *parser = parser_init(head_request);
+    parser->pos = pos;
+    parser->start = pos;
+}
+
+/**
+ * Parses a chunk-size line: hex digits, optionally followed by extensions.
+ * @param line The start of the line.
+ * @param size The line length, without CRLF.
+ * @param chunk_size Set to the parsed size.
+ * @return false if the line is malformed.
+ */
+static bool parse_chunk_size(const char *line, size_t size, size_t *chunk_size) {
+    size_t value = 0;
+    size_t digits = 0;
+
+    for (; digits < size; ++digits) {
+        char c = line[digits];
+        int nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else break;
+
+        // More than 15 hex digits would overflow
+        if (digits == 15) return false;
+        value = (value << 4) | nibble;
+    }
+
+    if (digits == 0 || (digits < size && line[digits] != ';' && line[digits] != ' ' && line[digits] != '\t')) {
+        return false;
+    }
+
+    *chunk_size = value;
+    return true;
+}
+
+/**
+ * Decodes the chunked body received so far. Chunk data is moved down
+ * over the framing bytes already consumed, so the decoded body always
+ * sits contiguously right after the headers and is usable while the
+ * rest of the response is still arriving.
+ * @param parser The parser.
+ * @param data The response bytes received so far.
+ * @param size The number of bytes received so far.
+ */
+static void parse_chunked_body(http_parser *parser, char *data, size_t size) {
+    while (parser->state == PARSER_BODY && parser->pos < size) {
+        if (parser->chunk == CHUNK_DATA) {
+            size_t available = size - parser->pos;
+            size_t n = parser->chunk_remaining < available ? parser->chunk_remaining : available;
+
+            memmove(data + parser->header_end + parser->body_size, data + parser->pos, n);
+            parser->body_size += n;
+            parser->pos += n;
+            parser->chunk_remaining -= n;
+
+            if (parser->chunk_remaining == 0) {
+                parser->chunk = CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        // Every other chunk state consumes one whole line
+        const char *newline = (const char *)memchr(data + parser->pos, '\n', size - parser->pos);
+        if (newline == NULL) {
+            return;
+        }
+
+        size_t start = parser->pos;
+        size_t end = newline - data;
+        parser->pos = end + 1;
+
+        size_t line_size = end - start;
+        if (line_size > 0 && data[end - 1] == '\r') --line_size;
+
+        switch (parser->chunk) {
+            case CHUNK_SIZE:
+                if (!parse_chunk_size(data + start, line_size, &parser->chunk_remaining)) {
+                    parser->state = PARSER_ERROR;
+                } else {
+                    parser->chunk = parser->chunk_remaining == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+                }
+                break;
+
+            case CHUNK_DATA_END:
+                if (line_size != 0) {
+                    parser->state = PARSER_ERROR;
+                } else {
+                    parser->chunk = CHUNK_SIZE;
+                }
+                break;
+
+            case CHUNK_TRAILER:
+                // Trailer fields are skipped, an empty line ends the message
+                if (line_size == 0) {
+                    parser->state = PARSER_DONE;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * Resumes parsing where the previous call stopped. Each byte of the
+ * status line and headers is scanned exactly once, however the
+ * response is split across reads.
+ * @param parser The parser.
+ * @param data The response bytes received so far (may have moved since the last call).
+ *             A chunked body is decoded in place.
+ * @param size The number of bytes received so far.
+ * @return The parser state after consuming the new bytes.
+ */
+parser_state parser_feed(http_parser *parser, char *data, size_t size) {
+    while (parser->state == PARSER_STATUS_LINE || parser->state == PARSER_HEADERS) {
+        const char *newline = (const char *)memchr(data + parser->pos, '\n', size - parser->pos);
+        if (newline == NULL) {
+            return parser->state;
+        }
+
+        size_t start = parser->pos;
+        size_t end = newline - data;
+        parser->pos = end + 1;
+
+        size_t line_size = end - start;
+        if (line_size > 0 && data[end - 1] == '\r') --line_size;
+
+        if (parser->state == PARSER_STATUS_LINE) {
+            parser->state = parse_status_line(parser, data + start, start, line_size)
+                ? PARSER_HEADERS : PARSER_ERROR;
+        } else if (line_size == 0 && parser->status_code < 200 && parser->status_code != 101) {
+            // 101 hands the connection over, any other 1xx is followed by the real reply
+            skip_interim_head(parser);
+        } else if (line_size == 0) {
+            parser->header_end = parser->pos;
+            parser->state = parse_body_framing(parser) ? PARSER_BODY : PARSER_ERROR;
+        } else if (!parse_header_line(parser, data, start, line_size)) {
+            parser->state = PARSER_ERROR;
+        }
+    }
+
+    if (parser->state != PARSER_BODY) {
+        return parser->state;
+    }
+
+    if (parser->chunked) {
+        parse_chunked_body(parser, data, size);
+    } else if (parser->close_delimited) {
+        parser->body_size = size - parser->header_end;
+        parser->pos = size;
+    } else {
+        size_t available = size - parser->header_end;
+        size_t length = (size_t)parser->content_length - parser->body_discarded;
+
+        parser->body_size = available < length ? available : length;
+        parser->pos = parser->header_end + parser->body_size;
+        if (parser->body_size == length) {
+            parser->state = PARSER_DONE;
+        }
+    }
+
+    return parser->state;
+}
+
+/**
+ * Ends parsing because the server closed the connection. Only a
+ * close-delimited body may legitimately end this way.
+ * @param parser The parser.
+ * @return PARSER_DONE if the response is complete, PARSER_ERROR if truncated.
+ */
+parser_state parser_finish(http_parser *parser) {
+    if (parser->state == PARSER_BODY && parser->close_delimited) {
+        parser->state = PARSER_DONE;
+    } else if (parser->state != PARSER_DONE) {
+        parser->state = PARSER_ERROR;
+    }
+    return parser->state;
+}
+
+/**
+ * Drops the decoded body bytes parsed so far, once the caller is done
+ * with them, so a body of any size can be read through a buffer of
+ * constant size. Bytes received but not parsed yet (chunk framing, or
+ * the start of the next response) are moved down right after the
+ * headers, where the next decoded body bytes will be stored.
+ * @param parser The parser.
+ * @param data The response bytes received so far.
+ * @param size The number of bytes received so far.
+ * @return The number of bytes left in data.
+ */
+size_t parser_discard_body(http_parser *parser, char *data, size_t size) {
+    size_t unparsed = size - parser->pos;
+    memmove(data + parser->header_end, data + parser->pos, unparsed);
+
+    parser->body_discarded += parser->body_size;
+    parser->body_size = 0;
+    parser->pos = parser->header_end;
+    return parser->header_end + unparsed;
+}
+
+/**
+ * Returns the size of the decoded message: headers followed by the body,
+ * without any chunk framing.
+ * @param parser The parser.
+ * @return The message size in bytes.
+ */
+size_t parser_message_size(const http_parser *parser) {
+    return parser->header_end + parser->body_size;
+}
+
+/**
+ * Finds a header by name, ignoring case.
+ * @param parser The parser.
+ * @param data The response bytes.
+ * @param name The header name.
+ * @return The header, or NULL if absent.
+ */
+const http_header *parser_header(const http_parser *parser, const char *data, const char *name) {
+    for (size_t i = 0; i < parser->headers_count; ++i) {
+        if (header_is(data, &parser->headers[i], name)) {
+            return &parser->headers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Hashes a header name, ignoring case (FNV-1a over folded bytes).
+ * @param name The header name.
+ * @return The hash.
+ */
+static unsigned header_hash(std::string_view name) {
+    unsigned hash = 2166136261u;
+    for (char c : name) {
+        hash ^= (unsigned char)(c | 0x20);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Builds a view of a parsed response. The status line, headers and body
+ * are exposed as views into `message`, and the headers are indexed by a
+ * small open-addressing table, so lookups cost one hash and usually one
+ * comparison. Nothing is allocated.
+ * @param response The response to fill.
+ * @param parser The parser that consumed the message.
+ * @param message The decoded message, as returned by the receive path.
+ */
+void response_init(http_response *response, const http_parser *parser, std::string_view message) {
+    response->raw = message.substr(parser->start);
+    response->code = std::string_view();
+    response->reason = std::string_view();
+    response->body = std::string_view();
+    response->status = 0;
+    response->headers_count = 0;
+    memset(response->index, 0, sizeof(response->index));
+
+    if (parser->state == PARSER_STATUS_LINE || parser->state == PARSER_ERROR) {
+        return;
+    }
+
+    response->status = parser->status_code;
+    response->code = message.substr(parser->start + 9, 3);
+    response->reason = message.substr(parser->reason, parser->reason_size);
+
+    for (size_t i = 0; i < parser->headers_count; ++i) {
+        const http_header *header = &parser->headers[i];
+        http_field *field = &response->headers[response->headers_count++];
+        field->name = message.substr(header->name, header->name_size);
+        field->value = message.substr(header->value, header->value_size);
+
+        // Repeated names keep their first occurrence in the index
+        unsigned slot = header_hash(field->name) & (HTTP_INDEX_SIZE - 1);
+        while (response->index[slot] != 0) {
+            const http_field *other = &response->headers[response->index[slot] - 1];
+            if (other->name.size() == field->name.size() &&
+                strncasecmp(other->name.data(), field->name.data(), field->name.size()) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (HTTP_INDEX_SIZE - 1);
+        }
+        if (response->index[slot] == 0) {
+            response->index[slot] = (unsigned char)response->headers_count;
+        }
+    }
+
+    if (parser->state == PARSER_DONE || parser->state == PARSER_BODY) {
+        response->body = message.substr(parser->header_end, parser->body_size);
+    }
+}
+
+/**
+ * Finds a header value by name, ignoring case.
+ * @param response The response.
+ * @param name The header name.
+ * @return The value, or an empty view if the header is absent.
+ */
+std::string_view response_header(const http_response *response, std::string_view name) {
+    unsigned slot = header_hash(name) & (HTTP_INDEX_SIZE - 1);
+
+    while (response->index[slot] != 0) {
+        const http_field *field = &response->headers[response->index[slot] - 1];
+        if (field->name.size() == name.size() &&
+            strncasecmp(field->name.data(), name.data(), name.size()) == 0) {
+            return field->value;
+        }
+        slot = (slot + 1) & (HTTP_INDEX_SIZE - 1);
+    }
+
+    return std::string_view();
+}
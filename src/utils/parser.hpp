@@ -0,0 +1,107 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <stddef.h>
+#include <string_view>
+
+#define HTTP_MAX_HEADERS 32
+
+// Slots of the hashed header index, a power of two above HTTP_MAX_HEADERS
+#define HTTP_INDEX_SIZE 64
+
+// Largest Content-Length accepted, far above any book list (1 GiB)
+#define HTTP_MAX_CONTENT_LENGTH (1L << 30)
+
+// Parser progress through a response
+typedef enum {
+    PARSER_STATUS_LINE,
+    PARSER_HEADERS,
+    PARSER_BODY,
+    PARSER_DONE,
+    PARSER_ERROR
+} parser_state;
+
+// Position inside a chunked body
+typedef enum {
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_DATA_END,
+    CHUNK_TRAILER
+} chunk_state;
+
+// Header field, stored as offsets into the response bytes
+typedef struct {
+    size_t name;
+    size_t name_size;
+    size_t value;
+    size_t value_size;
+} http_header;
+
+// Resumable HTTP response parser
+typedef struct {
+    parser_state state;
+    bool head_request;         // answers a HEAD request, so never has a body
+    size_t pos;                // first byte not scanned yet
+    size_t start;              // offset of the final status line, past any 1xx heads
+    int status_code;
+    size_t reason;
+    size_t reason_size;
+    http_header headers[HTTP_MAX_HEADERS];
+    size_t headers_count;
+    size_t header_end;         // offset of the first body byte
+    long content_length;       // -1 if the header is absent
+    bool keep_alive;           // false for HTTP/1.0 or "Connection: close"
+    bool chunked;              // "Transfer-Encoding: chunked"
+    bool transfer_encoded;     // any Transfer-Encoding header
+    bool close_delimited;      // body runs until the server closes
+    chunk_state chunk;
+    size_t chunk_remaining;    // bytes left in the current chunk
+    size_t body_size;          // decoded body bytes, stored from header_end
+    size_t body_discarded;     // decoded body bytes dropped by parser_discard_body()
+} http_parser;
+
+// Header field as views into the response bytes
+typedef struct {
+    std::string_view name;
+    std::string_view value;
+} http_field;
+
+// Parsed response: views into the received bytes, nothing is copied
+typedef struct {
+    std::string_view raw;                    // whole decoded message
+    std::string_view code;                   // status code, e.g. "200"
+    std::string_view reason;                 // reason phrase, e.g. "OK"
+    std::string_view body;
+    int status;                              // status code, 0 if not received
+    http_field headers[HTTP_MAX_HEADERS];
+    size_t headers_count;
+    unsigned char index[HTTP_INDEX_SIZE];    // header number + 1, 0 for a free slot
+} http_response;
+
+// Initializes a parser for the reply to a request, HEAD or any other method
+http_parser parser_init(bool head_request = false);
+
+// Resumes parsing over the first size bytes of data and returns the new state.
+// Chunked bodies are decoded in place, so data is modified.
+parser_state parser_feed(http_parser *parser, char *data, size_t size);
+
+// Signals that the server closed the connection and returns the final state
+parser_state parser_finish(http_parser *parser);
+
+// Drops the decoded body bytes parsed so far and returns the new size of data.
+// Bytes not parsed yet are moved down right after the headers.
+size_t parser_discard_body(http_parser *parser, char *data, size_t size);
+
+// Size of the decoded message (headers and body) once the parser is done
+size_t parser_message_size(const http_parser *parser);
+
+// Finds a header by case-insensitive name, returns NULL if absent
+const http_header *parser_header(const http_parser *parser, const char *data, const char *name);
+
+// Builds the response view of a message parsed by parser
+void response_init(http_response *response, const http_parser *parser, std::string_view message);
+
+// Finds a header value by case-insensitive name, returns an empty view if absent
+std::string_view response_header(const http_response *response, std::string_view name);
+
+#endif // PARSER_HPP
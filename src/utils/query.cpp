@@ -0,0 +1,583 @@
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#include "query.hpp"
+#include "search.hpp"
+
+// A limit this many times smaller than the matches is served by a top-K heap
+// instead of sorting every match
+#define QUERY_HEAP_RATIO 16
+
+// Sort key of a matching book: its position and the order of its value
+typedef struct {
+    uint64_t key;   // compares like the value (the first 8 bytes of a title)
+    uint32_t row;
+} query_key;
+
+// Names of the fields, by query_field
+static const char *const QUERY_FIELD_NAMES[QUERY_FIELDS] = {
+    "id", "title", "author", "genre", "publisher", "page_count"
+};
+
+// Operators by spelling, two-byte ones first so "<=" is not read as "<"
+static const struct {
+    const char *text;
+    query_op op;
+} QUERY_OPS[] = {
+    {"!=", QUERY_NE}, {"<=", QUERY_LE}, {">=", QUERY_GE},
+    {"=", QUERY_EQ}, {"<", QUERY_LT}, {">", QUERY_GT}, {"~", QUERY_CONTAINS}
+};
+
+/**
+ * @param c A byte.
+ * @return The byte, with ASCII letters in lowercase.
+ */
+static inline unsigned char query_fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/**
+ * Compares two strings ignoring ASCII case.
+ * @param a The first string.
+ * @param b The second string.
+ * @return Negative, 0 or positive as a sorts before, with or after b.
+ */
+static int query_compare_text(std::string_view a, std::string_view b) {
+    size_t size = std::min(a.size(), b.size());
+    for (size_t i = 0; i < size; ++i) {
+        int diff = (int)query_fold(a[i]) - (int)query_fold(b[i]);
+        if (diff != 0) {
+            return diff;
+        }
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size();
+}
+
+/**
+ * @param field A field.
+ * @return true if its values are numbers.
+ */
+static bool query_numeric(int field) {
+    return field == QUERY_ID || field == QUERY_PAGE_COUNT;
+}
+
+/**
+ * Looks a field up by name.
+ * @param name The name, in any case.
+ * @return The field, or -1 if there is none by that name.
+ */
+int query_find_field(std::string_view name) {
+    for (int field = 0; field < QUERY_FIELDS; ++field) {
+        if (query_compare_text(name, QUERY_FIELD_NAMES[field]) == 0) {
+            return field;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @param field A field.
+ * @return Its name.
+ */
+const char *query_field_name(int field) {
+    return QUERY_FIELD_NAMES[field];
+}
+
+/**
+ * Reads a whole non-negative number.
+ * @param text The text.
+ * @param number Set to the number.
+ * @return false if the text is not only digits, or too long.
+ */
+static bool query_number(std::string_view text, long *number) {
+    if (text.empty() || text.size() > 18) {
+        return false;
+    }
+
+    *number = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        *number = *number * 10 + (c - '0');
+    }
+    return true;
+}
+
+/**
+ * Splits a query at spaces, except those between double quotes; the
+ * quotes themselves are dropped.
+ * @param text The query.
+ * @param words Filled with the words.
+ * @return false if a quote is left open.
+ */
+static bool query_split(std::string_view text, std::vector<std::string> *words) {
+    std::string word;
+    bool quoted = false;
+    bool started = false;
+
+    for (char c : text) {
+        if (c == '"') {
+            quoted = !quoted;
+            started = true;
+        } else if (c == ' ' && !quoted) {
+            if (started) {
+                words->push_back(word);
+            }
+            word.clear();
+            started = false;
+        } else {
+            word += c;
+            started = true;
+        }
+    }
+
+    if (started) {
+        words->push_back(word);
+    }
+    return !quoted;
+}
+
+/**
+ * Initializes a query listing every book in catalog order.
+ * @return The query.
+ */
+book_query query_init(void) {
+    book_query query;
+    query.sort = -1;
+    query.descending = false;
+    query.limit = 0;
+    return query;
+}
+
+/**
+ * @param query The query.
+ * @return true if it lists every book in catalog order.
+ */
+bool query_empty(const book_query *query) {
+    return query->filters.empty() && query->sort < 0 && query->limit == 0;
+}
+
+/**
+ * Parses a query, e.g. `author="Frank Herbert" page_count>300 sort=-title
+ * limit=10`. A word is a field name, an operator (= != < <= > >= ~) and a
+ * value; `sort` and `limit` take their value after `=`.
+ * @param text The query.
+ * @param query Set to the query.
+ * @param error Set to the reason the text was rejected.
+ * @return false if the text is not a valid query.
+ */
+bool query_parse(std::string_view text, book_query *query, std::string *error) {
+    *query = query_init();
+
+    std::vector<std::string> words;
+    if (!query_split(text, &words)) {
+        *error = "Unterminated quote in the query!";
+        return false;
+    }
+
+    for (const std::string &word : words) {
+        // The name runs up to the operator
+        size_t end = 0;
+        while (end < word.size() && (isalnum((unsigned char)word[end]) || word[end] == '_')) {
+            ++end;
+        }
+        std::string_view name(word.data(), end);
+        std::string_view rest(word.data() + end, word.size() - end);
+
+        query_filter filter;
+        size_t op_size = 0;
+        for (const auto &op : QUERY_OPS) {
+            size_t size = strlen(op.text);
+            if (rest.compare(0, size, op.text) == 0) {
+                filter.op = op.op;
+                op_size = size;
+                break;
+            }
+        }
+        if (name.empty() || op_size == 0) {
+            *error = "Expected field=value, not \"" + word + "\"!";
+            return false;
+        }
+        std::string_view value = rest.substr(op_size);
+
+        if (query_compare_text(name, "sort") == 0 || query_compare_text(name, "limit") == 0) {
+            bool sort = query_compare_text(name, "sort") == 0;
+            long number = 0;
+
+            if (filter.op != QUERY_EQ) {
+                *error = sort ? "Use sort=field or sort=-field!" : "Use limit=number!";
+                return false;
+            }
+
+            if (sort) {
+                query->descending = !value.empty() && value[0] == '-';
+                query->sort = query_find_field(value.substr(query->descending ? 1 : 0));
+                if (query->sort < 0) {
+                    *error = "Cannot sort by \"" + std::string(value) + "\"!";
+                    return false;
+                }
+            } else if (!query_number(value, &number) || number == 0) {
+                *error = "The limit must be a positive number!";
+                return false;
+            } else {
+                query->limit = (size_t)number;
+            }
+            continue;
+        }
+
+        int field = query_find_field(name);
+        if (field < 0) {
+            *error = "Unknown field \"" + std::string(name) + "\"!";
+            return false;
+        }
+        filter.field = (query_field)field;
+
+        if (query_numeric(field)) {
+            if (filter.op == QUERY_CONTAINS) {
+                *error = "Only text fields can be matched with ~!";
+                return false;
+            }
+            if (!query_number(value, &filter.number)) {
+                *error = "The " + std::string(QUERY_FIELD_NAMES[field]) + " must be a number!";
+                return false;
+            }
+        } else {
+            filter.number = 0;
+            filter.text = value;
+        }
+        query->filters.push_back(filter);
+    }
+    return true;
+}
+
+/**
+ * Checks a string against a filter.
+ * @param value The string.
+ * @param filter The filter, on a string field.
+ * @return true if the filter holds.
+ */
+static bool query_match_text(std::string_view value, const query_filter *filter) {
+    if (filter->op == QUERY_CONTAINS) {
+        return filter->text.empty() ||
+               search_find_insensitive(value.data(), value.size(), filter->text.data(), filter->text.size()) >= 0;
+    }
+
+    int order = query_compare_text(value, filter->text);
+    switch (filter->op) {
+        case QUERY_EQ: return order == 0;
+        case QUERY_NE: return order != 0;
+        case QUERY_LT: return order < 0;
+        case QUERY_LE: return order <= 0;
+        case QUERY_GT: return order > 0;
+        default: return order >= 0;
+    }
+}
+
+/**
+ * Clears the mask of the books a numeric filter rejects. Every comparison
+ * is turned into a range, so one branch-free loop (vectorized by the
+ * compiler) covers them all; unknown values (-1) never match.
+ * @param column The numeric column.
+ * @param count The number of books.
+ * @param filter The filter.
+ * @param mask 1 for each book still matching.
+ */
+static void query_filter_numbers(const long *column, size_t count, const query_filter *filter, uint8_t *mask) {
+    long value = filter->number;
+
+    if (filter->op == QUERY_NE) {
+        for (size_t i = 0; i < count; ++i) {
+            mask[i] &= (uint8_t)((column[i] >= 0) & (column[i] != value));
+        }
+        return;
+    }
+
+    long low = 0;
+    long high = LONG_MAX;
+    switch (filter->op) {
+        case QUERY_EQ: low = value, high = value; break;
+        case QUERY_LT: high = value - 1; break;
+        case QUERY_LE: high = value; break;
+        case QUERY_GT: low = value + 1; break;
+        default: low = value; break;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        mask[i] &= (uint8_t)((column[i] >= low) & (column[i] <= high));
+    }
+}
+
+/**
+ * Clears the mask of the books an interned-string filter rejects. The
+ * filter is checked once per distinct string of the pool, then each book
+ * only looks its code up in that table.
+ * @param pool The intern pool.
+ * @param codes The column of codes.
+ * @param count The number of books.
+ * @param filter The filter.
+ * @param mask 1 for each book still matching.
+ */
+static void query_filter_codes(const intern_pool *pool, const uint32_t *codes, size_t count,
+                               const query_filter *filter, uint8_t *mask) {
+    size_t strings = pool->offsets.size() - 1;
+    std::vector<uint8_t> table(strings);
+    for (size_t code = 0; code < strings; ++code) {
+        table[code] = query_match_text(intern_get(pool, (uint32_t)code), filter);
+    }
+
+    const uint8_t *match = table.data();
+    for (size_t i = 0; i < count; ++i) {
+        mask[i] &= match[codes[i]];
+    }
+}
+
+/**
+ * Packs 8 bytes of a title into a key that compares like them, ignoring
+ * case: folded, big-endian, and padded with zeros past the end.
+ * @param title The title.
+ * @param offset The first byte packed.
+ * @return The key.
+ */
+static uint64_t query_title_key(std::string_view title, size_t offset) {
+    uint64_t key = 0;
+    for (size_t j = offset; j < offset + 8; ++j) {
+        key = (key << 8) | (j < title.size() ? query_fold(title[j]) : 0);
+    }
+    return key;
+}
+
+/**
+ * Orders a run of keys whose titles agree up to offset by the next 8
+ * bytes, then the position, and goes on with the runs still equal. Only
+ * integers are compared, never whole titles.
+ * @param catalog The catalog.
+ * @param keys The keys, in position order within the run.
+ * @param start The first key of the run.
+ * @param end Past the last key of the run.
+ * @param offset The bytes the titles of the run agree on.
+ * @param flip All ones for a descending sort.
+ */
+static void query_refine_titles(const catalog *catalog, std::vector<query_key> *keys, size_t start, size_t end,
+                                size_t offset, uint64_t flip) {
+    for (size_t run = start, next; run < end; run = next) {
+        for (next = run + 1; next < end && (*keys)[next].key == (*keys)[run].key; ++next) {
+        }
+        if (next - run < 2) {
+            continue;
+        }
+
+        // Titles all ending before offset are equal, and already in position order
+        bool longer = false;
+        for (size_t i = run; i < next; ++i) {
+            std::string_view title = catalog_title(catalog, (*keys)[i].row);
+            longer |= title.size() > offset;
+            (*keys)[i].key = query_title_key(title, offset) ^ flip;
+        }
+        if (!longer) {
+            continue;
+        }
+
+        std::sort(keys->begin() + run, keys->begin() + next, [](const query_key &a, const query_key &b) {
+            return a.key != b.key ? a.key < b.key : a.row < b.row;
+        });
+        query_refine_titles(catalog, keys, run, next, offset + 8, flip);
+    }
+}
+
+/**
+ * Fills the sort keys of the matching books.
+ * @param query The query, with a sort field.
+ * @param catalog The catalog.
+ * @param rows The positions of the matching books.
+ * @param keys Filled with a key per position.
+ */
+static void query_keys(const book_query *query, const catalog *catalog, const std::vector<uint32_t> &rows,
+                       std::vector<query_key> *keys) {
+    keys->resize(rows.size());
+    uint64_t flip = query->descending ? ~0ull : 0;
+
+    if (query_numeric(query->sort)) {
+        // Flipping the sign bit orders signed values as unsigned
+        const long *column = query->sort == QUERY_ID ? catalog->ids.data() : catalog->page_counts.data();
+        for (size_t i = 0; i < rows.size(); ++i) {
+            (*keys)[i].key = ((uint64_t)column[rows[i]] ^ (1ull << 63)) ^ flip;
+            (*keys)[i].row = rows[i];
+        }
+    } else if (query->sort == QUERY_TITLE) {
+        // The first 8 bytes; equal keys are ordered after the sort
+        for (size_t i = 0; i < rows.size(); ++i) {
+            (*keys)[i].key = query_title_key(catalog_title(catalog, rows[i]), 0) ^ flip;
+            (*keys)[i].row = rows[i];
+        }
+    } else {
+        // Interned strings: the rank of the code among the distinct strings, equal ones sharing it
+        const intern_pool *pool = &catalog->strings;
+        std::vector<uint32_t> order(pool->offsets.size() - 1);
+        for (size_t code = 0; code < order.size(); ++code) {
+            order[code] = (uint32_t)code;
+        }
+        std::sort(order.begin(), order.end(), [pool](uint32_t a, uint32_t b) {
+            return query_compare_text(intern_get(pool, a), intern_get(pool, b)) < 0;
+        });
+
+        std::vector<uint32_t> rank(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            bool same = i > 0 && query_compare_text(intern_get(pool, order[i - 1]), intern_get(pool, order[i])) == 0;
+            rank[order[i]] = same ? rank[order[i - 1]] : (uint32_t)i;
+        }
+
+        const uint32_t *codes = query->sort == QUERY_AUTHOR ? catalog->authors.data()
+                              : query->sort == QUERY_GENRE ? catalog->genres.data()
+                              : catalog->publishers.data();
+        for (size_t i = 0; i < rows.size(); ++i) {
+            (*keys)[i].key = (uint64_t)rank[codes[rows[i]]] ^ flip;
+            (*keys)[i].row = rows[i];
+        }
+    }
+}
+
+/**
+ * Sorts keys by value, then position: an LSD radix sort on the 64-bit
+ * key, 8 bits per pass, skipping the bytes every key shares. Keys come in
+ * position order and each pass is stable, so equal keys keep it.
+ * @param keys The keys.
+ */
+static void query_radix_sort(std::vector<query_key> *keys) {
+    size_t count = keys->size();
+    std::vector<size_t> counts(8 * 256, 0);
+    for (const query_key &key : *keys) {
+        for (int pass = 0; pass < 8; ++pass) {
+            ++counts[pass * 256 + ((key.key >> (8 * pass)) & 0xFF)];
+        }
+    }
+
+    std::vector<query_key> other(count);
+    for (int pass = 0; pass < 8; ++pass) {
+        size_t *bucket = &counts[pass * 256];
+        if (std::find(bucket, bucket + 256, count) != bucket + 256) {
+            continue;
+        }
+
+        size_t start = 0;
+        for (int byte = 0; byte < 256; ++byte) {
+            size_t size = bucket[byte];
+            bucket[byte] = start;
+            start += size;
+        }
+
+        for (const query_key &key : *keys) {
+            other[bucket[(key.key >> (8 * pass)) & 0xFF]++] = key;
+        }
+        keys->swap(other);
+    }
+}
+
+/**
+ * Sorts the matching books and cuts them to the limit: a top-K heap when
+ * the limit is far below the number of matches, a radix sort otherwise.
+ * @param query The query, with a sort field.
+ * @param catalog The catalog.
+ * @param rows The positions of the matching books, reordered.
+ */
+static void query_sort(const book_query *query, const catalog *catalog, std::vector<uint32_t> *rows) {
+    std::vector<query_key> keys;
+    query_keys(query, catalog, *rows, &keys);
+
+    // Full order: the key, the whole title when sorting by title, then the position
+    bool titles = query->sort == QUERY_TITLE;
+    bool descending = query->descending;
+    auto before = [catalog, titles, descending](const query_key &a, const query_key &b) {
+        if (a.key != b.key) {
+            return a.key < b.key;
+        }
+        if (titles) {
+            int order = query_compare_text(catalog_title(catalog, a.row), catalog_title(catalog, b.row));
+            if (order != 0) {
+                return descending ? order > 0 : order < 0;
+            }
+        }
+        return a.row < b.row;
+    };
+
+    if (query->limit > 0 && query->limit <= keys.size() / QUERY_HEAP_RATIO) {
+        // Keep the limit best books in a max-heap: most books lose to its top at once
+        std::vector<query_key> heap(keys.begin(), keys.begin() + query->limit);
+        std::make_heap(heap.begin(), heap.end(), before);
+        for (size_t i = query->limit; i < keys.size(); ++i) {
+            if (before(keys[i], heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), before);
+                heap.back() = keys[i];
+                std::push_heap(heap.begin(), heap.end(), before);
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), before);
+        keys.swap(heap);
+    } else {
+        query_radix_sort(&keys);
+
+        // Titles sharing their first 8 bytes are ordered by the rest
+        if (titles) {
+            query_refine_titles(catalog, &keys, 0, keys.size(), 8, query->descending ? ~0ull : 0);
+        }
+        if (query->limit > 0 && keys.size() > query->limit) {
+            keys.resize(query->limit);
+        }
+    }
+
+    rows->resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        (*rows)[i] = keys[i].row;
+    }
+}
+
+/**
+ * Runs a query. Numeric and interned-string filters are applied column
+ * by column to a mask of every book; title filters, which need the text
+ * of each book, only to the books still matching after them.
+ * @param query The query.
+ * @param catalog The catalog.
+ * @param rows Replaced with the positions listed, in order.
+ * @return The number of books matching, before the limit.
+ */
+size_t query_run(const book_query *query, const catalog *catalog, std::vector<uint32_t> *rows) {
+    size_t count = catalog->count;
+    std::vector<uint8_t> mask(count, 1);
+    std::vector<const query_filter *> titles;
+
+    for (const query_filter &filter : query->filters) {
+        switch (filter.field) {
+            case QUERY_ID: query_filter_numbers(catalog->ids.data(), count, &filter, mask.data()); break;
+            case QUERY_PAGE_COUNT: query_filter_numbers(catalog->page_counts.data(), count, &filter, mask.data()); break;
+            case QUERY_AUTHOR: query_filter_codes(&catalog->strings, catalog->authors.data(), count, &filter, mask.data()); break;
+            case QUERY_GENRE: query_filter_codes(&catalog->strings, catalog->genres.data(), count, &filter, mask.data()); break;
+            case QUERY_PUBLISHER: query_filter_codes(&catalog->strings, catalog->publishers.data(), count, &filter, mask.data()); break;
+            default: titles.push_back(&filter); break;
+        }
+    }
+
+    rows->clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (!mask[i]) {
+            continue;
+        }
+
+        bool match = true;
+        for (size_t f = 0; f < titles.size() && match; ++f) {
+            match = query_match_text(catalog_title(catalog, i), titles[f]);
+        }
+        if (match) {
+            rows->push_back((uint32_t)i);
+        }
+    }
+
+    size_t matched = rows->size();
+    if (query->sort >= 0) {
+        query_sort(query, catalog, rows);
+    } else if (query->limit > 0 && rows->size() > query->limit) {
+        rows->resize(query->limit);
+    }
+    return matched;
+}
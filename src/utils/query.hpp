@@ -0,0 +1,71 @@
+#ifndef QUERY_HPP
+#define QUERY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catalog.hpp"
+
+// Catalog columns a query can filter or sort by
+typedef enum {
+    QUERY_ID,
+    QUERY_TITLE,
+    QUERY_AUTHOR,
+    QUERY_GENRE,
+    QUERY_PUBLISHER,
+    QUERY_PAGE_COUNT,
+    QUERY_FIELDS
+} query_field;
+
+// Comparison of a filter; strings compare ignoring ASCII case
+typedef enum {
+    QUERY_EQ,        // =
+    QUERY_NE,        // !=
+    QUERY_LT,        // <
+    QUERY_LE,        // <=
+    QUERY_GT,        // >
+    QUERY_GE,        // >=
+    QUERY_CONTAINS   // ~, strings only
+} query_op;
+
+// One `field op value` condition
+typedef struct {
+    query_field field;
+    query_op op;
+    std::string text;   // the value, for string fields
+    long number;        // the value, for numeric fields
+} query_filter;
+
+// Conditions (all must hold), ordering and size of a book listing
+typedef struct {
+    std::vector<query_filter> filters;
+    int sort;           // query_field to sort by, -1 to keep catalog order
+    bool descending;
+    size_t limit;       // books listed at most, 0 for all
+} book_query;
+
+// Returns the field of a name (e.g. "page_count"), in any case, or -1 if unknown
+int query_find_field(std::string_view name);
+
+// Returns the name of a field
+const char *query_field_name(int field);
+
+// Initializes a query listing every book in catalog order
+book_query query_init(void);
+
+// true if the query lists every book in catalog order
+bool query_empty(const book_query *query);
+
+// Parses `field op value` filters, `sort=[-]field` and `limit=n`, separated by
+// spaces; values holding spaces are double-quoted. Returns false with a
+// message in error if the text is not a valid query.
+bool query_parse(std::string_view text, book_query *query, std::string *error);
+
+// Replaces rows with the positions of the books matching every filter, in the
+// query's order and cut to its limit; returns the number of books matching
+size_t query_run(const book_query *query, const catalog *catalog, std::vector<uint32_t> *rows);
+
+#endif // QUERY_HPP
@@ -0,0 +1,238 @@
+#include <string.h>
+
+#include "search.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SEARCH_X86 1
+#endif
+
+typedef long (*search_fn)(const char *, size_t, const char *, size_t);
+
+// ASCII lowercase, matching tolower() in the "C" locale
+static inline char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
+/**
+ * Compares two byte ranges ignoring ASCII case.
+ * @return true if equal.
+ */
+static inline bool equal_insensitive(const char *a, const char *b, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (fold(a[i]) != fold(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Scalar exact search: memchr() for the first byte, then memcmp().
+ */
+static long find_scalar(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const char *end = haystack + size - needle_size + 1;
+    const char *p = haystack;
+
+    while (p < end) {
+        p = (const char *)memchr(p, needle[0], end - p);
+        if (p == NULL) {
+            return -1;
+        }
+        if (memcmp(p + 1, needle + 1, needle_size - 1) == 0) {
+            return p - haystack;
+        }
+        ++p;
+    }
+
+    return -1;
+}
+
+/**
+ * Scalar case-insensitive search.
+ */
+static long find_insensitive_scalar(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const char first = fold(needle[0]);
+    size_t last_pos = size - needle_size + 1;
+
+    for (size_t i = 0; i < last_pos; ++i) {
+        if (fold(haystack[i]) == first && equal_insensitive(haystack + i + 1, needle + 1, needle_size - 1)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef SEARCH_X86
+
+/*
+ * The vector kernels compare a block of candidate positions at once
+ * against the first and the last byte of the needle, and only run a
+ * full comparison where both match. Whatever is left after the last
+ * full block goes to the scalar kernel.
+ */
+
+// Folds 'A'..'Z' to lowercase in 16 lanes (bytes >= 0x80 compare negative)
+static inline __m128i fold_sse2(__m128i x) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static long find_sse2(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+    size_t i = 0;
+
+    for (; i + 16 + needle_size - 1 <= size; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_size - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                        _mm_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (needle_size <= 2 || memcmp(haystack + pos + 1, needle + 1, needle_size - 2) == 0) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    long tail = find_scalar(haystack + i, size - i, needle, needle_size);
+    return tail < 0 ? -1 : (long)i + tail;
+}
+
+static long find_insensitive_sse2(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const __m128i first = _mm_set1_epi8(fold(needle[0]));
+    const __m128i last = _mm_set1_epi8(fold(needle[needle_size - 1]));
+    size_t i = 0;
+
+    for (; i + 16 + needle_size - 1 <= size; i += 16) {
+        __m128i block_first = fold_sse2(_mm_loadu_si128((const __m128i *)(haystack + i)));
+        __m128i block_last = fold_sse2(_mm_loadu_si128((const __m128i *)(haystack + i + needle_size - 1)));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                        _mm_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (needle_size <= 2 || equal_insensitive(haystack + pos + 1, needle + 1, needle_size - 2)) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    long tail = find_insensitive_scalar(haystack + i, size - i, needle, needle_size);
+    return tail < 0 ? -1 : (long)i + tail;
+}
+
+// Folds 'A'..'Z' to lowercase in 32 lanes
+__attribute__((target("avx2")))
+static inline __m256i fold_avx2(__m256i x) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), x));
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static long find_avx2(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+    size_t i = 0;
+
+    for (; i + 32 + needle_size - 1 <= size; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_size - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                        _mm256_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (needle_size <= 2 || memcmp(haystack + pos + 1, needle + 1, needle_size - 2) == 0) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    long tail = find_sse2(haystack + i, size - i, needle, needle_size);
+    return tail < 0 ? -1 : (long)i + tail;
+}
+
+__attribute__((target("avx2")))
+static long find_insensitive_avx2(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+    const __m256i first = _mm256_set1_epi8(fold(needle[0]));
+    const __m256i last = _mm256_set1_epi8(fold(needle[needle_size - 1]));
+    size_t i = 0;
+
+    for (; i + 32 + needle_size - 1 <= size; i += 32) {
+        __m256i block_first = fold_avx2(_mm256_loadu_si256((const __m256i *)(haystack + i)));
+        __m256i block_last = fold_avx2(_mm256_loadu_si256((const __m256i *)(haystack + i + needle_size - 1)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                        _mm256_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (needle_size <= 2 || equal_insensitive(haystack + pos + 1, needle + 1, needle_size - 2)) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    long tail = find_insensitive_sse2(haystack + i, size - i, needle, needle_size);
+    return tail < 0 ? -1 : (long)i + tail;
+}
+
+/**
+ * Picks the widest kernel the running CPU supports. Other targets use the
+ * scalar kernels directly.
+ * @param avx2 The AVX2 kernel.
+ * @param sse2 The SSE2 kernel.
+ * @return The selected kernel.
+ */
+static search_fn resolve(search_fn avx2, search_fn sse2) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return avx2;
+    return sse2; // always available on x86-64
+}
+
+#endif // SEARCH_X86
+
+/**
+ * Finds the first occurrence of a needle in a haystack.
+ * @param haystack The bytes to search.
+ * @param size The haystack length.
+ * @param needle The bytes to find.
+ * @param needle_size The needle length.
+ * @return The position of the match, or -1 if not found.
+ */
+long search_find(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+#ifdef SEARCH_X86
+    static const search_fn kernel = resolve(find_avx2, find_sse2);
+#else
+    static const search_fn kernel = find_scalar;
+#endif
+
+    if (haystack == NULL || needle == NULL || needle_size > size) return -1;
+    if (needle_size == 0) return 0;
+    return kernel(haystack, size, needle, needle_size);
+}
+
+/**
+ * Case-insensitive version of `search_find()` (ASCII letters only).
+ * @param haystack The bytes to search.
+ * @param size The haystack length.
+ * @param needle The bytes to find.
+ * @param needle_size The needle length.
+ * @return The position of the match, or -1 if not found.
+ */
+long search_find_insensitive(const char *haystack, size_t size, const char *needle, size_t needle_size) {
+#ifdef SEARCH_X86
+    static const search_fn kernel = resolve(find_insensitive_avx2, find_insensitive_sse2);
+#else
+    static const search_fn kernel = find_insensitive_scalar;
+#endif
+
+    if (haystack == NULL || needle == NULL || needle_size > size) return -1;
+    if (needle_size == 0) return 0;
+    return kernel(haystack, size, needle, needle_size);
+}
@@ -0,0 +1,13 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <stddef.h>
+
+// Finds needle in haystack and returns its position, or -1 if not found.
+// Uses AVX2 or SSE2 when the CPU supports them.
+long search_find(const char *haystack, size_t size, const char *needle, size_t needle_size);
+
+// ASCII case-insensitive version of search_find
+long search_find_insensitive(const char *haystack, size_t size, const char *needle, size_t needle_size);
+
+#endif // SEARCH_HPP
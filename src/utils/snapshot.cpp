@@ -0,0 +1,268 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <algorithm>
+
+#include "snapshot.hpp"
+#include "hash.hpp"
+#include "helpers.hpp"
+
+// Sections start on this boundary, so the arrays can be read in place
+#define SNAPSHOT_ALIGN 8
+
+// Bytes of zero padding written after a section
+static const char snapshot_padding[SNAPSHOT_ALIGN] = {0};
+
+/**
+ * Copies a section out of the mapping into a vector.
+ * @param map The mapped file.
+ * @param header Its header.
+ * @param section The section.
+ * @param out The vector, resized to the section.
+ */
+template <typename T>
+static void snapshot_copy(const char *map, const snapshot_header *header, int section, std::vector<T> *out) {
+    const T *first = (const T *)(map + header->offsets[section]);
+    out->assign(first, first + header->sizes[section] / sizeof(T));
+}
+
+/**
+ * Checks that every stored code and offset stays inside its arrays, so a
+ * file that passes the checksum but was written wrong cannot be read
+ * out of bounds, and that the id index is the one catalog_index() would
+ * build (each position once, in id order), since lookups and diffs
+ * binary-search and merge on it.
+ * @param catalog The loaded catalog.
+ * @return false if the catalog is inconsistent.
+ */
+static bool snapshot_consistent(const catalog *catalog) {
+    const intern_pool *pool = &catalog->strings;
+    size_t count = catalog->count;
+
+    if (catalog->title_offsets.size() != count + 1 || catalog->title_offsets[0] != 0 ||
+        pool->offsets.size() < 2 || pool->table.empty() ||
+        (pool->table.size() & (pool->table.size() - 1)) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (catalog->title_offsets[i + 1] < catalog->title_offsets[i]) return false;
+    }
+    if (catalog->title_offsets[count] > catalog->titles.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i + 1 < pool->offsets.size(); ++i) {
+        if (pool->offsets[i + 1] < pool->offsets[i]) return false;
+    }
+    if (pool->offsets.back() > pool->heap.size()) {
+        return false;
+    }
+
+    uint32_t codes = (uint32_t)pool->offsets.size() - 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (catalog->authors[i] >= codes || catalog->genres[i] >= codes || catalog->publishers[i] >= codes) {
+            return false;
+        }
+    }
+    for (uint32_t entry : pool->table) {
+        if (entry > codes) return false;
+    }
+
+    const long *ids = catalog->ids.data();
+    std::vector<bool> seen(count);
+    for (size_t i = 0; i < catalog->id_order.size(); ++i) {
+        uint32_t position = catalog->id_order[i];
+        if (position >= count || seen[position]) return false;
+        seen[position] = true;
+
+        if (i > 0) {
+            uint32_t previous = catalog->id_order[i - 1];
+            if (ids[previous] > ids[position] || (ids[previous] == ids[position] && previous > position)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes a snapshot. The sections are the catalog's own arrays, written
+ * as they are in memory and hashed on the way; the header, holding the
+ * checksum, is written last, and the file is renamed over `path` once
+ * complete. It is not synced: this runs on the command thread, and a
+ * file torn by a crash fails its checksum on load and only costs a cold
+ * start.
+ * @param path The snapshot file.
+ * @param catalog The catalog.
+ * @param memo The memo of the body the catalog was parsed from.
+ * @param validators The validators of that body.
+ * @return false on failure.
+ */
+bool snapshot_save(const char *path, const catalog *catalog, const catalog_memo *memo,
+                   const cache_validators *validators) {
+    // The id index is stored whole; build it here if the catalog has none
+    std::vector<uint32_t> order;
+    const std::vector<uint32_t> *id_order = &catalog->id_order;
+    if (id_order->size() != catalog->count) {
+        const long *ids = catalog->ids.data();
+        order.resize(catalog->count);
+        for (size_t i = 0; i < catalog->count; ++i) {
+            order[i] = (uint32_t)i;
+        }
+        std::stable_sort(order.begin(), order.end(), [ids](uint32_t a, uint32_t b) { return ids[a] < ids[b]; });
+        id_order = &order;
+    }
+
+    const intern_pool *pool = &catalog->strings;
+    const void *data[SNAPSHOT_SECTIONS] = {
+        catalog->ids.data(), catalog->page_counts.data(), catalog->title_offsets.data(),
+        catalog->titles.data(), catalog->authors.data(), catalog->genres.data(),
+        catalog->publishers.data(), pool->heap.data(), pool->offsets.data(), pool->table.data(),
+        id_order->data(), validators->etag.data(), validators->last_modified.data()
+    };
+
+    snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.endian = SNAPSHOT_ENDIAN;
+    header.count = catalog->count;
+    header.memo_size = memo->size;
+    header.memo_hash = memo->hash;
+    header.sizes[SNAPSHOT_IDS] = catalog->ids.size() * sizeof(long);
+    header.sizes[SNAPSHOT_PAGE_COUNTS] = catalog->page_counts.size() * sizeof(long);
+    header.sizes[SNAPSHOT_TITLE_OFFSETS] = catalog->title_offsets.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_TITLES] = catalog->titles.size();
+    header.sizes[SNAPSHOT_AUTHORS] = catalog->authors.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_GENRES] = catalog->genres.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_PUBLISHERS] = catalog->publishers.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_HEAP] = pool->heap.size();
+    header.sizes[SNAPSHOT_HEAP_OFFSETS] = pool->offsets.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_HEAP_TABLE] = pool->table.size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_ID_ORDER] = id_order->size() * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_ETAG] = validators->etag.size();
+    header.sizes[SNAPSHOT_LAST_MODIFIED] = validators->last_modified.size();
+
+    uint64_t offset = sizeof(header);
+    for (int i = 0; i < SNAPSHOT_SECTIONS; ++i) {
+        header.offsets[i] = offset;
+        offset += (header.sizes[i] + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+    }
+
+    std::string temporary = std::string(path) + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Sections first, after room for the header
+    hash64_state hash;
+    hash64_init(&hash, 0);
+    bool ok = lseek(fd, sizeof(header), SEEK_SET) == (off_t)sizeof(header);
+
+    for (int i = 0; ok && i < SNAPSHOT_SECTIONS; ++i) {
+        size_t padding = (SNAPSHOT_ALIGN - header.sizes[i] % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+        if (header.sizes[i] == 0) {
+            // An empty vector or string may have no storage at all
+            continue;
+        }
+        ok = writeAll(fd, data[i], header.sizes[i]) && writeAll(fd, snapshot_padding, padding);
+        hash64_update(&hash, data[i], header.sizes[i]);
+        hash64_update(&hash, snapshot_padding, padding);
+    }
+
+    header.checksum = hash64_digest(&hash);
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(temporary.c_str(), path) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Loads a snapshot. The file is mapped, its header and checksum checked,
+ * and each section copied into the catalog with a single copy: nothing
+ * is parsed and the intern pool index is used as stored.
+ * @param path The snapshot file.
+ * @param catalog Replaced with the stored catalog.
+ * @param memo Replaced with the stored memo (its counters are kept).
+ * @param validators Given the stored ETag and Last-Modified.
+ * @return false if nothing was loaded.
+ */
+bool snapshot_load(const char *path, catalog *catalog, catalog_memo *memo, cache_validators *validators) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(snapshot_header)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const char *map = (const char *)mapping;
+    const snapshot_header *header = (const snapshot_header *)map;
+    uint64_t count = header->count;
+
+    bool ok = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == SNAPSHOT_VERSION && header->endian == SNAPSHOT_ENDIAN;
+
+    // Every section inside the file and aligned, per-book arrays of the right length
+    for (int i = 0; ok && i < SNAPSHOT_SECTIONS; ++i) {
+        ok = header->offsets[i] % SNAPSHOT_ALIGN == 0 && header->offsets[i] <= size &&
+             header->sizes[i] <= size - header->offsets[i];
+    }
+    ok = ok && count < UINT32_MAX &&
+         header->sizes[SNAPSHOT_IDS] == count * sizeof(long) &&
+         header->sizes[SNAPSHOT_PAGE_COUNTS] == count * sizeof(long) &&
+         header->sizes[SNAPSHOT_TITLE_OFFSETS] == (count + 1) * sizeof(uint32_t) &&
+         header->sizes[SNAPSHOT_AUTHORS] == count * sizeof(uint32_t) &&
+         header->sizes[SNAPSHOT_GENRES] == count * sizeof(uint32_t) &&
+         header->sizes[SNAPSHOT_PUBLISHERS] == count * sizeof(uint32_t) &&
+         header->sizes[SNAPSHOT_ID_ORDER] == count * sizeof(uint32_t);
+
+    ok = ok && hash64(map + sizeof(snapshot_header), size - sizeof(snapshot_header), 0) == header->checksum;
+
+    ::catalog loaded;
+    if (ok) {
+        loaded.count = count;
+        snapshot_copy(map, header, SNAPSHOT_IDS, &loaded.ids);
+        snapshot_copy(map, header, SNAPSHOT_PAGE_COUNTS, &loaded.page_counts);
+        snapshot_copy(map, header, SNAPSHOT_TITLE_OFFSETS, &loaded.title_offsets);
+        snapshot_copy(map, header, SNAPSHOT_TITLES, &loaded.titles);
+        snapshot_copy(map, header, SNAPSHOT_AUTHORS, &loaded.authors);
+        snapshot_copy(map, header, SNAPSHOT_GENRES, &loaded.genres);
+        snapshot_copy(map, header, SNAPSHOT_PUBLISHERS, &loaded.publishers);
+        snapshot_copy(map, header, SNAPSHOT_HEAP, &loaded.strings.heap);
+        snapshot_copy(map, header, SNAPSHOT_HEAP_OFFSETS, &loaded.strings.offsets);
+        snapshot_copy(map, header, SNAPSHOT_HEAP_TABLE, &loaded.strings.table);
+        snapshot_copy(map, header, SNAPSHOT_ID_ORDER, &loaded.id_order);
+        ok = snapshot_consistent(&loaded);
+    }
+
+    if (ok) {
+        validators->etag.assign(map + header->offsets[SNAPSHOT_ETAG], header->sizes[SNAPSHOT_ETAG]);
+        validators->last_modified.assign(map + header->offsets[SNAPSHOT_LAST_MODIFIED],
+                                         header->sizes[SNAPSHOT_LAST_MODIFIED]);
+        memo->size = header->memo_size;
+        memo->hash = header->memo_hash;
+        std::swap(*catalog, loaded);
+    }
+
+    munmap(mapping, size);
+    return ok;
+}
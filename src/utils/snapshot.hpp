@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "catalog.hpp"
+#include "cache.hpp"
+
+// First bytes of every snapshot file
+#define SNAPSHOT_MAGIC "BOOKSNAP"
+
+// Bumped whenever the layout below changes, older files are then ignored
+#define SNAPSHOT_VERSION 1
+
+// Written as is, read back differently on a machine of the other byte order
+#define SNAPSHOT_ENDIAN 0x01020304u
+
+// Sections of a snapshot, each an array copied as is from the catalog
+typedef enum {
+    SNAPSHOT_IDS,             // int64 per book
+    SNAPSHOT_PAGE_COUNTS,     // int64 per book
+    SNAPSHOT_TITLE_OFFSETS,   // uint32, count + 1
+    SNAPSHOT_TITLES,          // title bytes
+    SNAPSHOT_AUTHORS,         // uint32 codes per book
+    SNAPSHOT_GENRES,
+    SNAPSHOT_PUBLISHERS,
+    SNAPSHOT_HEAP,            // intern pool bytes
+    SNAPSHOT_HEAP_OFFSETS,    // intern pool offsets
+    SNAPSHOT_HEAP_TABLE,      // intern pool index
+    SNAPSHOT_ID_ORDER,        // uint32 positions sorted by id
+    SNAPSHOT_ETAG,            // validators of the list the catalog came from
+    SNAPSHOT_LAST_MODIFIED,
+    SNAPSHOT_SECTIONS
+} snapshot_section;
+
+// Fixed-size file header; sections follow, each aligned to 8 bytes
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t checksum;        // hash64() of every byte after the header
+    uint64_t count;           // books
+    uint64_t memo_size;       // catalog_memo of the list
+    uint64_t memo_hash;
+    uint64_t offsets[SNAPSHOT_SECTIONS];  // from the start of the file
+    uint64_t sizes[SNAPSHOT_SECTIONS];    // in bytes
+} snapshot_header;
+
+// Writes the catalog, its memo and the list validators to path, atomically: a
+// temporary file is written and renamed over path. Returns false on failure.
+bool snapshot_save(const char *path, const catalog *catalog, const catalog_memo *memo,
+                   const cache_validators *validators);
+
+// Maps path and loads it into catalog, memo and validators (etag and last_modified).
+// Returns false, leaving them untouched, if the file is missing, of another version or corrupt.
+bool snapshot_load(const char *path, catalog *catalog, catalog_memo *memo, cache_validators *validators);
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,329 @@
+#include <string.h>
+#include <algorithm>
+
+#include "trigram.hpp"
+#include "hash.hpp"
+#include "search.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TRIGRAM_X86 1
+#endif
+
+/**
+ * Folds a byte to its 6-bit code: letters ignoring case, digits and the
+ * space get their own code, every other byte shares the remaining ones.
+ * Codes shared by several bytes only add candidates, which the final
+ * substring check removes.
+ * @param c The byte.
+ * @return The code, 1..63.
+ */
+static inline uint32_t trigram_code(unsigned char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a' + 1;
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 1;
+    if (c >= '0' && c <= '9') return c - '0' + 27;
+    if (c == ' ') return 37;
+    return 38 + c % 26;
+}
+
+/**
+ * Calls visit(slot) for every trigram of a text, duplicates included.
+ * @param text The text.
+ * @param visit The callback.
+ */
+template <typename Visit>
+static void trigram_each(std::string_view text, Visit visit) {
+    if (text.size() < 3) {
+        return;
+    }
+
+    uint32_t slot = (trigram_code(text[0]) << TRIGRAM_BITS) | trigram_code(text[1]);
+    for (size_t i = 2; i < text.size(); ++i) {
+        slot = ((slot << TRIGRAM_BITS) | trigram_code(text[i])) & (TRIGRAM_SLOTS - 1);
+        visit(slot);
+    }
+}
+
+/**
+ * Appends a position to a list, as the varint of its distance to the
+ * previous one. Positions are added in increasing order.
+ * @param list The list.
+ * @param position The position.
+ */
+static void posting_add(posting_list *list, uint32_t position) {
+    uint32_t delta = list->count == 0 ? position : position - list->last;
+    while (delta >= 0x80) {
+        list->bytes.push_back((uint8_t)(delta | 0x80));
+        delta >>= 7;
+    }
+    list->bytes.push_back((uint8_t)delta);
+    list->last = position;
+    ++list->count;
+}
+
+/**
+ * Decodes a list.
+ * @param list The list.
+ * @param out Replaced with its positions.
+ */
+static void posting_decode(const posting_list *list, std::vector<uint32_t> *out) {
+    out->resize(list->count);
+    const uint8_t *p = list->bytes.data();
+    uint32_t position = 0;
+
+    for (uint32_t i = 0; i < list->count; ++i) {
+        uint32_t delta = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            delta |= (uint32_t)(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        delta |= (uint32_t)*p++ << shift;
+
+        position = i == 0 ? delta : position + delta;
+        (*out)[i] = position;
+    }
+}
+
+/**
+ * Drops the positions from `books` on. Varints are walked back from the
+ * end (only the last byte of each has its high bit clear), so the cost
+ * is the number of positions dropped, not the length of the list.
+ * @param list The list.
+ * @param books The first position dropped.
+ */
+static void posting_truncate(posting_list *list, uint32_t books) {
+    while (list->count > 0 && list->last >= books) {
+        size_t end = list->bytes.size();
+        size_t start = end - 1;
+        while (start > 0 && (list->bytes[start - 1] & 0x80)) {
+            --start;
+        }
+
+        uint32_t delta = 0;
+        for (size_t i = end; i-- > start;) {
+            delta = (delta << 7) | (list->bytes[i] & 0x7F);
+        }
+
+        list->bytes.resize(start);
+        list->last = --list->count == 0 ? 0 : list->last - delta;
+    }
+}
+
+/**
+ * Scalar merge of two sorted lists.
+ * @return The number of positions written to out.
+ */
+static size_t intersect_scalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            out[k++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+/**
+ * Intersects two sorted lists without duplicates. Blocks of four are
+ * compared against the four rotations of the other list's block; the
+ * block with the smaller last value is then passed.
+ * @param a The first list.
+ * @param na Its length.
+ * @param b The second list.
+ * @param nb Its length.
+ * @param out Receives the common positions, room for min(na, nb); may alias a.
+ * @return The number of positions written.
+ */
+static size_t intersect(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+
+#ifdef TRIGRAM_X86
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + j));
+
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+
+        uint32_t a_last = a[i + 3], b_last = b[j + 3];
+        for (int mask = _mm_movemask_ps(_mm_castsi128_ps(hits)); mask != 0; mask &= mask - 1) {
+            out[k++] = a[i + __builtin_ctz(mask)];
+        }
+
+        if (a_last <= b_last) i += 4;
+        if (b_last <= a_last) j += 4;
+    }
+#endif
+
+    return k + intersect_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+/**
+ * Hashes the indexed fields of a book, to tell whether it changed.
+ * @param catalog The catalog.
+ * @param i The position of the book.
+ * @return The hash.
+ */
+static uint64_t trigram_row(const catalog *catalog, size_t i) {
+    std::string_view fields[3] = {catalog_title(catalog, i), catalog_author(catalog, i),
+                                  catalog_publisher(catalog, i)};
+    hash64_state hash;
+    hash64_init(&hash, (uint64_t)catalog->ids[i]);
+    for (std::string_view field : fields) {
+        uint32_t size = (uint32_t)field.size();
+        hash64_update(&hash, &size, sizeof(size));
+        hash64_update(&hash, field.data(), field.size());
+    }
+    return hash64_digest(&hash);
+}
+
+/**
+ * Initializes an empty index.
+ * @return The index.
+ */
+trigram_index trigram_init(void) {
+    trigram_index index;
+    index.source = 0;
+    index.books = 0;
+    index.lists.assign(TRIGRAM_SLOTS, posting_list{std::vector<uint8_t>(), 0, 0});
+    return index;
+}
+
+/**
+ * Updates the index after the catalog changed. A catalog with the same
+ * source and size as the one indexed is taken as unchanged, in O(1).
+ * Otherwise the books are compared by hash up to the first one that
+ * differs; only the books from there on are indexed again, so a list
+ * that only grew, or changed near its end, costs little.
+ * @param index The index.
+ * @param catalog The catalog.
+ * @param source Identifies the catalog's content.
+ * @return The number of books indexed.
+ */
+size_t trigram_update(trigram_index *index, const catalog *catalog, uint64_t source) {
+    if (index->source == source && index->books == catalog->count) {
+        return 0;
+    }
+
+    // Keep the books up to the first one that changed
+    size_t kept = 0;
+    size_t limit = std::min(index->books, catalog->count);
+    while (kept < limit && index->rows[kept] == trigram_row(catalog, kept)) {
+        ++kept;
+    }
+
+    if (kept < index->books) {
+        for (posting_list &list : index->lists) {
+            posting_truncate(&list, (uint32_t)kept);
+        }
+        index->rows.resize(kept);
+    }
+
+    // Index the rest; a list already ending with the book skips its repeated trigrams
+    for (size_t i = kept; i < catalog->count; ++i) {
+        std::string_view fields[3] = {catalog_title(catalog, i), catalog_author(catalog, i),
+                                      catalog_publisher(catalog, i)};
+        uint32_t position = (uint32_t)i;
+        for (std::string_view field : fields) {
+            trigram_each(field, [index, position](uint32_t slot) {
+                posting_list *list = &index->lists[slot];
+                if (list->count == 0 || list->last != position) {
+                    posting_add(list, position);
+                }
+            });
+        }
+        index->rows.push_back(trigram_row(catalog, i));
+    }
+
+    index->source = source;
+    index->books = catalog->count;
+    return catalog->count - kept;
+}
+
+/**
+ * Checks a candidate: the trigrams only say the text may be there.
+ * @return true if a field of the book contains text.
+ */
+static bool trigram_match(const catalog *catalog, size_t i, std::string_view text) {
+    std::string_view fields[3] = {catalog_title(catalog, i), catalog_author(catalog, i),
+                                  catalog_publisher(catalog, i)};
+    for (std::string_view field : fields) {
+        if (field.size() >= text.size() &&
+            search_find_insensitive(field.data(), field.size(), text.data(), text.size()) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Searches the indexed books. The posting lists of the text's trigrams
+ * are intersected, shortest first, and the candidates left are checked.
+ * A text shorter than a trigram is checked against every book.
+ * @param index The index, up to date with catalog.
+ * @param catalog The catalog.
+ * @param text The text.
+ * @param matches Receives the positions of the matching books.
+ */
+void trigram_search(const trigram_index *index, const catalog *catalog, std::string_view text,
+                    std::vector<uint32_t> *matches) {
+    if (text.empty()) {
+        return;
+    }
+
+    if (text.size() < 3) {
+        for (size_t i = 0; i < index->books; ++i) {
+            if (trigram_match(catalog, i, text)) matches->push_back((uint32_t)i);
+        }
+        return;
+    }
+
+    std::vector<const posting_list *> lists;
+    trigram_each(text, [&](uint32_t slot) { lists.push_back(&index->lists[slot]); });
+    std::sort(lists.begin(), lists.end());
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    std::sort(lists.begin(), lists.end(),
+              [](const posting_list *a, const posting_list *b) { return a->count < b->count; });
+
+    std::vector<uint32_t> candidates, other;
+    posting_decode(lists[0], &candidates);
+
+    // Once few candidates are left, checking them costs less than decoding a long list
+    for (size_t l = 1; l < lists.size() && !candidates.empty(); ++l) {
+        if (candidates.size() * 32 < lists[l]->count) {
+            break;
+        }
+
+        posting_decode(lists[l], &other);
+        size_t size = intersect(candidates.data(), candidates.size(), other.data(), other.size(),
+                                candidates.data());
+        candidates.resize(size);
+    }
+
+    for (uint32_t i : candidates) {
+        if (trigram_match(catalog, i, text)) matches->push_back(i);
+    }
+}
+
+/**
+ * Sums the bytes of the posting lists and the row hashes.
+ * @param index The index.
+ * @return The size in bytes.
+ */
+size_t trigram_memory(const trigram_index *index) {
+    size_t size = index->lists.size() * sizeof(posting_list) + index->rows.size() * sizeof(uint64_t);
+    for (const posting_list &list : index->lists) {
+        size += list.bytes.size();
+    }
+    return size;
+}
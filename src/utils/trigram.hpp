@@ -0,0 +1,46 @@
+#ifndef TRIGRAM_HPP
+#define TRIGRAM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+#include "catalog.hpp"
+
+// Bytes are folded to 6-bit codes, so a trigram is one of 2^18 slots
+#define TRIGRAM_BITS 6
+#define TRIGRAM_SLOTS (1 << (3 * TRIGRAM_BITS))
+
+// Sorted book positions holding one trigram, delta and varint encoded
+typedef struct {
+    std::vector<uint8_t> bytes;
+    uint32_t last;      // last position added
+    uint32_t count;
+} posting_list;
+
+// Trigram index over the titles, authors and publishers of a catalog
+typedef struct {
+    uint64_t source;                  // identifies the catalog indexed, see trigram_update()
+    size_t books;                     // catalog positions indexed
+    std::vector<uint64_t> rows;       // hash of each indexed book, to find the first one that changed
+    std::vector<posting_list> lists;  // TRIGRAM_SLOTS lists, indexed by trigram
+} trigram_index;
+
+// Initializes an empty index
+trigram_index trigram_init(void);
+
+// Brings the index up to date with catalog, whose content is identified by source
+// (e.g. the hash of the body it was parsed from). Books before the first one that
+// changed are kept; returns the number of books (re)indexed.
+size_t trigram_update(trigram_index *index, const catalog *catalog, uint64_t source);
+
+// Appends the positions of the books whose title, author or publisher contains
+// text (ignoring ASCII case), in catalog order
+void trigram_search(const trigram_index *index, const catalog *catalog, std::string_view text,
+                    std::vector<uint32_t> *matches);
+
+// Bytes held by the index
+size_t trigram_memory(const trigram_index *index);
+
+#endif // TRIGRAM_HPP